@@ -0,0 +1,1044 @@
+/* Measures loading, lexing, parsing and tree traversal with GoldCPP.
+
+Usage:
+  benchmark [--repeat N] [--sizes N,N,...] [--flatten] [--eliminate-units] <grammar>=<file.egt>[@<input>] ...
+
+<grammar> is json, sql, minic or calc for the grammars in benchmark/grammars,
+next to which their compiled EGT files are. Inputs of the given sizes (in characters) are generated for them. Any other grammar needs an
+input file after '@', which is parsed as is.
+
+Each measurement is printed as one line of JSON, such as
+
+  {"grammar":"json","chars":100000,"phase":"lex","ms":1.92,"mchars_per_s":52.1,
+   "items":23410,"allocs":23411,"alloc_bytes":2472344,"peak_bytes":2110032}
+
+'ms' is the best of the repeated runs. 'items' is what the phase produces:
+tokens when lexing, reductions when parsing, nodes when walking the tree.
+The 'relex' phase makes 200 small edits to the text, each followed by
+IncrementalLexer::Update(), and its 'items' are the tokens lexed again.
+Allocations are counted in one run, and 'peak_bytes' is the most heap memory
+the run had in use on top of what was in use before it. For 'load', 'chars'
+is the size of the EGT file. With --flatten, lists are parsed into flat
+nodes, see Parser::FlattenLists(). With --eliminate-units, unit reductions
+are taken out of the tables, see Parser::EliminateUnitProductions(), and
+'load' includes the time that takes.
+
+A "tables" line gives the memory used by the loaded tables by
+Parser::GetTableMemory(), and "tree" lines the size of the parse trees by
+MeasureTree(). 'heap_bytes' is what the heap counts say for comparison:
+the growth of the heap when loading, and what freeing the tree gave back.
+'reduction_size' and 'token_size' are the sizes of the node objects.
+
+Built with GOLDCPP_STATS defined, a "stats" line with the counts of
+Parser::GetStats() follows the parse measurement.
+
+Built with GOLDCPP_SHARED_TABLES defined, the loaded tables are published
+to shared memory, and an 'attach' line measures SharedTableSegment::Attach(),
+which other processes call instead of loading. Its 'chars' is the size of the
+EGT file as well. The benchmark fails if the attached tables parse the input
+otherwise than the loaded ones.
+
+Before measuring the 'relex' phase, the tokens after each edit are checked
+against those of lexing all of the edited text, on the first 10000
+characters, with and without Parser::SkipNoiseRuns. The benchmark fails if
+they differ, or if an input does not parse. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/Parser.h"
+#include "../src/SimpleParser.h"
+#include "../src/IncrementalLexer.h"
+#include "../src/SharedTables.h"
+#include "../src/utf8/checked.h"
+
+using namespace GoldCPP;
+
+// ===== Heap accounting. Each block carries its size in front of it.
+
+namespace
+{
+  struct HeapCounters
+  {
+    size_t Allocs;
+    size_t Bytes;
+    size_t Live;
+    size_t Peak;
+  };
+
+  HeapCounters Heap = { 0, 0, 0, 0 };
+  const size_t kHeader = 16;      // Keeps the alignment of malloc()
+}
+
+void* operator new(size_t size)
+{
+  char *block = (char*)std::malloc(size + kHeader);
+  if (block == NULL)
+    throw std::bad_alloc();
+
+  *(size_t*)block = size;
+  ++Heap.Allocs;
+  Heap.Bytes += size;
+  Heap.Live += size;
+  if (Heap.Live > Heap.Peak)
+    Heap.Peak = Heap.Live;
+
+  return block + kHeader;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  if (ptr == NULL)
+    return;
+
+  char *block = (char*)ptr - kHeader;
+  Heap.Live -= *(size_t*)block;
+  std::free(block);
+}
+
+namespace
+{
+  // ===== Measuring
+
+  struct Result
+  {
+    double Ms;
+    size_t Items;
+    size_t Allocs;
+    size_t AllocBytes;
+    size_t PeakBytes;
+  };
+
+  class Meter
+  {
+  private:
+    HeapCounters Start_;
+    std::chrono::steady_clock::time_point Time_;
+
+  public:
+
+    void Begin()
+    {
+      Start_ = Heap;
+      Heap.Peak = Heap.Live;
+      Time_ = std::chrono::steady_clock::now();
+    }
+
+    void End(Result &result)
+    {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      result.Ms = std::chrono::duration<double, std::milli>(now - Time_).count();
+      result.Allocs = Heap.Allocs - Start_.Allocs;
+      result.AllocBytes = Heap.Bytes - Start_.Bytes;
+      result.PeakBytes = Heap.Peak - Start_.Live;
+      if (Start_.Peak > Heap.Peak)
+        Heap.Peak = Start_.Peak;
+    }
+  };
+
+  /* Runs 'phase' 'repeat' times, each time after 'prepare', which is not
+  measured. Keeps the best time and the counts of the first run. */
+  template <typename Prepare, typename Phase>
+  Result Measure(int repeat, Prepare prepare, Phase phase)
+  {
+    Result best = { 0, 0, 0, 0, 0 };
+    for (int r = 0; r < repeat; ++r)
+    {
+      Meter meter;
+      Result result = { 0, 0, 0, 0, 0 };
+      prepare();
+      meter.Begin();
+      result.Items = phase();
+      meter.End(result);
+
+      if (r == 0)
+        best = result;
+      else if (result.Ms < best.Ms)
+        best.Ms = result.Ms;
+    }
+
+    return best;
+  }
+
+  template <typename Phase>
+  Result Measure(int repeat, Phase phase)
+  {
+    return Measure(repeat, []() {}, phase);
+  }
+
+  void Report(const std::string &grammar, size_t chars, const char *phase, const Result &result)
+  {
+    double perSecond = (result.Ms > 0) ? (chars / 1000.0) / result.Ms : 0;
+    std::printf("{\"grammar\":\"%s\",\"chars\":%lu,\"phase\":\"%s\",\"ms\":%.3f,\"mchars_per_s\":%.2f,"
+      "\"items\":%lu,\"allocs\":%lu,\"alloc_bytes\":%lu,\"peak_bytes\":%lu}\n",
+      grammar.c_str(), (unsigned long)chars, phase, result.Ms, perSecond,
+      (unsigned long)result.Items, (unsigned long)result.Allocs, (unsigned long)result.AllocBytes,
+      (unsigned long)result.PeakBytes);
+    std::fflush(stdout);
+  }
+
+  void ReportTables(const std::string &grammar, const TableMemory &memory, size_t heapBytes)
+  {
+    std::printf("{\"grammar\":\"%s\",\"phase\":\"tables\",\"symbols\":%lu,\"dfa\":%lu,\"charsets\":%lu,"
+      "\"productions\":%lu,\"lalr\":%lu,\"groups\":%lu,\"other\":%lu,\"bytes\":%lu,\"heap_bytes\":%lu}\n",
+      grammar.c_str(), (unsigned long)memory.Symbols, (unsigned long)memory.Dfa, (unsigned long)memory.CharacterSets,
+      (unsigned long)memory.Productions, (unsigned long)memory.LRStates, (unsigned long)memory.Groups,
+      (unsigned long)memory.Other, (unsigned long)memory.Total(), (unsigned long)heapBytes);
+    std::fflush(stdout);
+  }
+
+  void ReportTree(const std::string &grammar, size_t chars, const char *phase, const TreeMemory &memory, size_t heapBytes)
+  {
+    std::printf("{\"grammar\":\"%s\",\"chars\":%lu,\"phase\":\"%s\",\"reductions\":%lu,\"tokens\":%lu,"
+      "\"text_bytes\":%lu,\"bytes\":%lu,\"heap_bytes\":%lu,\"reduction_size\":%lu,\"token_size\":%lu}\n",
+      grammar.c_str(), (unsigned long)chars, phase, (unsigned long)memory.Reductions, (unsigned long)memory.Tokens,
+      (unsigned long)memory.TextBytes, (unsigned long)memory.Bytes, (unsigned long)heapBytes,
+      (unsigned long)sizeof(Reduction), (unsigned long)sizeof(Token));
+    std::fflush(stdout);
+  }
+
+#ifdef GOLDCPP_STATS
+  void ReportStats(const std::string &grammar, size_t chars, const ParseStats &stats)
+  {
+    std::printf("{\"grammar\":\"%s\",\"chars\":%lu,\"phase\":\"stats\",\"tokens\":%llu,\"content\":%llu,"
+      "\"noise\":%llu,\"noise_runs\":%llu,\"dfa_transitions\":%llu,\"characters\":%llu,\"shifts\":%llu,"
+      "\"reductions\":%llu,\"trimmed\":%llu,\"list_appends\":%llu,\"max_stack\":%lu,\"max_groups\":%lu,\"token_allocs\":%llu,"
+      "\"reduction_allocs\":%llu,\"lex_ms\":%.3f,\"lalr_ms\":%.3f}\n",
+      grammar.c_str(), (unsigned long)chars, (unsigned long long)stats.TotalTokens(),
+      (unsigned long long)stats.Tokens[Symbol::SymbolType::Content], (unsigned long long)stats.Tokens[Symbol::SymbolType::Noise],
+      (unsigned long long)stats.NoiseRuns, (unsigned long long)stats.DfaTransitions, (unsigned long long)stats.Characters,
+      (unsigned long long)stats.Shifts, (unsigned long long)stats.Reductions, (unsigned long long)stats.TrimmedReductions,
+      (unsigned long long)stats.ListAppends, (unsigned long)stats.MaxStackDepth, (unsigned long)stats.MaxGroupDepth, (unsigned long long)stats.TokenAllocations,
+      (unsigned long long)stats.ReductionAllocations, stats.LexNanoseconds / 1e6, stats.ParseNanoseconds / 1e6);
+    std::fflush(stdout);
+  }
+#endif
+
+  // ===== Inputs for the grammars in benchmark/grammars
+
+  class Generator
+  {
+  private:
+    std::mt19937 Random_;
+
+  protected:
+    std::string Out_;
+
+    size_t Pick(size_t count)
+    {
+      return Random_() % count;
+    }
+
+    bool Chance(int percent)
+    {
+      return (int)(Random_() % 100) < percent;
+    }
+
+    void Number()
+    {
+      Out_ += std::to_string(Random_() % 100000);
+    }
+
+    void Name(const char *prefix)
+    {
+      Out_ += prefix;
+      Out_ += std::to_string(Random_() % 500);
+    }
+
+  public:
+
+    Generator() :
+      Random_(12345)
+    {}
+
+    virtual ~Generator()
+    {}
+
+    virtual void Item() = 0;
+
+    std::string Generate(size_t size)
+    {
+      Out_.clear();
+      while (Out_.size() < size)
+        Item();
+      return Out_;
+    }
+  };
+
+  class JsonGenerator : public Generator
+  {
+  private:
+    void Value(int depth)
+    {
+      size_t kind = Pick(depth > 3 ? 5 : 7);
+      switch (kind)
+      {
+      case 0: Out_ += "\"text "; Number(); Out_ += " \\\"quoted\\\" \\u00e9\""; break;
+      case 1: Number(); Out_ += ".25e-3"; break;
+      case 2: Out_ += "-"; Number(); break;
+      case 3: Out_ += Chance(50) ? "true" : "false"; break;
+      case 4: Out_ += "null"; break;
+      case 5:
+        {
+        size_t count = Pick(6);
+        Out_ += "{";
+        for (size_t i = 0; i < count; ++i)
+        {
+          Out_ += (i > 0) ? ",\n" : "\n";
+          Out_ += std::string(depth * 2 + 2, ' ');
+          Out_ += "\""; Name("key"); Out_ += "\": ";
+          Value(depth + 1);
+        }
+        Out_ += "}";
+        break;
+        }
+      default:
+        {
+        size_t count = Pick(8);
+        Out_ += "[";
+        for (size_t i = 0; i < count; ++i)
+        {
+          if (i > 0)
+            Out_ += ", ";
+          Value(depth + 1);
+        }
+        Out_ += "]";
+        break;
+        }
+      }
+    }
+
+  public:
+
+    /* The whole input is a single array of objects. */
+    void Item()
+    {
+      Out_ += Out_.empty() ? "[\n" : ",\n";
+      Value(3);
+    }
+
+    std::string Finish(const std::string &text)
+    {
+      return text + "\n]\n";
+    }
+  };
+
+  class SqlGenerator : public Generator
+  {
+  private:
+    void Field()
+    {
+      if (Chance(30))
+      {
+        Name("t"); Out_ += ".";
+      }
+      Name("col");
+    }
+
+    void Value(int depth)
+    {
+      switch (Pick(depth > 1 ? 4 : 6))
+      {
+      case 0: Field(); break;
+      case 1: Number(); break;
+      case 2: Out_ += "'name "; Number(); Out_ += "'"; break;
+      case 3: Number(); Out_ += ".5"; break;
+      case 4: Out_ += "("; Expr(depth + 1); Out_ += ")"; break;
+      default:
+        if (Chance(50))
+          Out_ += "count(*)";
+        else
+        {
+          Out_ += "max("; Field(); Out_ += ")";
+        }
+        break;
+      }
+    }
+
+    void Sum(int depth)
+    {
+      Value(depth);
+      while (Chance(30))
+      {
+        static const char *ops[] = { " + ", " - ", " * ", " / " };
+        Out_ += ops[Pick(4)];
+        Value(depth);
+      }
+    }
+
+    void Predicate(int depth)
+    {
+      if (Chance(10))
+        Out_ += "NOT ";
+      Sum(depth);
+      switch (Pick(5))
+      {
+      case 0: Out_ += " IS NULL"; break;
+      case 1: Out_ += " IN (1, 2, "; Number(); Out_ += ")"; break;
+      case 2: Out_ += " LIKE 'abc%'"; break;
+      default:
+        {
+        static const char *ops[] = { " = ", " <> ", " < ", " > ", " <= ", " >= " };
+        Out_ += ops[Pick(6)];
+        Sum(depth);
+        break;
+        }
+      }
+    }
+
+    void Expr(int depth)
+    {
+      Predicate(depth);
+      while (Chance(40))
+      {
+        Out_ += Chance(50) ? " AND " : " OR ";
+        Predicate(depth);
+      }
+    }
+
+    void Where()
+    {
+      if (Chance(80))
+      {
+        Out_ += "\n  WHERE ";
+        Expr(0);
+      }
+    }
+
+  public:
+
+    void Item()
+    {
+      if (Chance(5))
+        Out_ += "-- Statement " + std::to_string(Out_.size()) + "\n";
+
+      switch (Pick(4))
+      {
+      case 0:
+        {
+        Out_ += "SELECT ";
+        size_t count = 1 + Pick(5);
+        for (size_t i = 0; i < count; ++i)
+        {
+          if (i > 0)
+            Out_ += ", ";
+          Sum(0);
+          if (Chance(20))
+          {
+            Out_ += " AS "; Name("c");
+          }
+        }
+        Out_ += "\n  FROM "; Name("t");
+        if (Chance(30))
+        {
+          Out_ += ", "; Name("t");
+        }
+        Where();
+        if (Chance(30))
+        {
+          Out_ += "\n  ORDER BY "; Field(); Out_ += Chance(50) ? " ASC" : " DESC";
+        }
+        break;
+        }
+      case 1:
+        Out_ += "INSERT INTO "; Name("t"); Out_ += " (a, b, c) VALUES ("; Number(); Out_ += ", 'x', "; Sum(0); Out_ += ")";
+        break;
+      case 2:
+        Out_ += "UPDATE "; Name("t"); Out_ += " SET "; Name("col"); Out_ += " = "; Sum(0);
+        Where();
+        break;
+      default:
+        Out_ += "DELETE FROM "; Name("t");
+        Where();
+        break;
+      }
+      Out_ += ";\n";
+    }
+  };
+
+  class MiniCGenerator : public Generator
+  {
+  private:
+    void Indent(int depth)
+    {
+      Out_ += std::string(depth * 4, ' ');
+    }
+
+    void Value(int depth)
+    {
+      switch (Pick(depth > 2 ? 3 : 5))
+      {
+      case 0: Name("v"); break;
+      case 1: Number(); break;
+      case 2: Name("a"); Out_ += "["; Name("i"); Out_ += "]"; break;
+      case 3: Out_ += "("; Expr(depth + 1); Out_ += ")"; break;
+      default: Name("f"); Out_ += "("; Expr(depth + 1); Out_ += ", "; Value(depth + 1); Out_ += ")"; break;
+      }
+    }
+
+    void Expr(int depth)
+    {
+      static const char *ops[] = {
+        " + ", " - ", " * ", " / ", " % ", " < ", " >= ", " == ", " != ", " && ", " || ", " << ", " & "
+      };
+      if (Chance(10))
+        Out_ += "-";
+      Value(depth);
+      while (Chance(45))
+      {
+        Out_ += ops[Pick(13)];
+        Value(depth);
+      }
+    }
+
+    void Block(int depth)
+    {
+      Out_ += "{\n";
+      size_t count = 1 + Pick(depth > 2 ? 3 : 6);
+      for (size_t i = 0; i < count; ++i)
+        Stmt(depth + 1);
+      Indent(depth);
+      Out_ += "}";
+    }
+
+    void Stmt(int depth)
+    {
+      Indent(depth);
+      switch (Pick(depth > 2 ? 4 : 7))
+      {
+      case 0: Out_ += "int "; Name("v"); Out_ += " = "; Expr(0); Out_ += ";"; break;
+      case 1: Name("v"); Out_ += Chance(50) ? " = " : " += "; Expr(0); Out_ += ";"; break;
+      case 2: Name("f"); Out_ += "("; Name("v"); Out_ += ", \"text\");"; break;
+      case 3: Out_ += "return "; Expr(0); Out_ += ";"; break;
+      case 4:
+        Out_ += "if ("; Expr(0); Out_ += ") "; Block(depth);
+        if (Chance(40))
+        {
+          Out_ += " else "; Block(depth);
+        }
+        break;
+      case 5: Out_ += "while ("; Expr(0); Out_ += ") "; Block(depth); break;
+      default:
+        Out_ += "for ("; Name("i"); Out_ += " = 0; "; Name("i"); Out_ += " < "; Number(); Out_ += "; "; Name("i"); Out_ += "++) ";
+        Block(depth);
+        break;
+      }
+      if (Chance(10))
+        Out_ += "   // Note";
+      Out_ += "\n";
+    }
+
+  public:
+
+    void Item()
+    {
+      if (Chance(30))
+        Out_ += "/* Function number " + std::to_string(Out_.size()) + "\n   with a block comment */\n";
+      Out_ += Chance(50) ? "int " : "void ";
+      Name("f");
+      Out_ += "(int a, float b) ";
+      Block(0);
+      Out_ += "\n\n";
+    }
+  };
+
+  class CalcGenerator : public Generator
+  {
+  private:
+    void Value(int depth)
+    {
+      switch (Pick(depth > 2 ? 4 : 7))
+      {
+      case 0: Name("x"); break;
+      case 1: Number(); break;
+      case 2: Out_ += "\"text "; Number(); Out_ += "\""; break;
+      case 3: Out_ += "[[raw\n text]]"; break;
+      case 4: Out_ += "-"; Value(depth + 1); break;
+      case 5: Out_ += "("; Expr(depth + 1); Out_ += ")"; break;
+      default: Name("f"); Out_ += "("; Expr(depth + 1); Out_ += ", "; Value(depth + 1); Out_ += ")"; break;
+      }
+    }
+
+    void Expr(int depth)
+    {
+      static const char *ops[] = { " + ", " - ", " * ", "/" };
+      Value(depth);
+      while (Chance(40))
+      {
+        Out_ += ops[Pick(4)];
+        Value(depth);
+      }
+    }
+
+    void Stmt(int depth)
+    {
+      Out_ += std::string(depth * 2, ' ');
+      switch (Pick(depth > 1 ? 3 : 4))
+      {
+      case 0: Out_ += "let "; Name("x"); Out_ += " = "; Expr(0); Out_ += ";"; break;
+      case 1:
+        Out_ += "print ";
+        Expr(0);
+        while (Chance(40))
+        {
+          Out_ += ", "; Expr(0);
+        }
+        Out_ += ";";
+        break;
+      case 2: Expr(0); Out_ += ";"; break;
+      default:
+        {
+        Out_ += "if "; Expr(0); Out_ += " then\n";
+        size_t count = 1 + Pick(4);
+        for (size_t i = 0; i < count; ++i)
+          Stmt(depth + 1);
+        Out_ += std::string(depth * 2, ' ');
+        Out_ += "end";
+        break;
+        }
+      }
+      if (Chance(10))
+        Out_ += "   // Note";
+      Out_ += "\n";
+    }
+
+  public:
+
+    void Item()
+    {
+      if (Chance(5))
+        Out_ += "/* Statement " + std::to_string(Out_.size()) + ",\n   /* nested */ comment */\n";
+      Stmt(0);
+    }
+  };
+
+  std::string MakeInput(const std::string &grammar, size_t size)
+  {
+    if (grammar == "json")
+    {
+      JsonGenerator json;
+      return json.Finish(json.Generate(size));
+    }
+    if (grammar == "sql")
+      return SqlGenerator().Generate(size);
+    if (grammar == "minic")
+      return MiniCGenerator().Generate(size);
+    if (grammar == "calc")
+      return CalcGenerator().Generate(size);
+    return std::string();
+  }
+
+  // ===== Edits
+
+  struct Edit
+  {
+    size_t Offset;
+    size_t Removed;
+    GPSTR_T Text;
+  };
+
+  /* Small random edits, one after the other, inserting pieces of 'source'.
+  Every eighth one is at the start of the text, as many are at its end. */
+  std::vector<Edit> MakeEdits(const GPSTR_T &source, size_t count)
+  {
+    std::mt19937 random(54321);
+    std::vector<Edit> edits(count);
+    size_t size = source.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+      Edit &edit = edits[i];
+      switch (random() % 8)
+      {
+      case 0: edit.Offset = 0; break;
+      case 1: edit.Offset = size; break;
+      default: edit.Offset = random() % (size + 1); break;
+      }
+      edit.Removed = std::min<size_t>(random() % 4, size - edit.Offset);
+      edit.Text = source.substr(random() % (source.size() + 1), random() % 5);
+      size = size - edit.Removed + edit.Text.size();
+    }
+
+    return edits;
+  }
+
+  TextEdit ApplyEdit(GPSTR_T &text, const Edit &edit)
+  {
+    text.replace(edit.Offset, edit.Removed, edit.Text);
+    return TextEdit(edit.Offset, edit.Removed, edit.Text.size());
+  }
+
+  /* Relexes 'source' after each edit, and compares the tokens with lexing
+  all of the text. Returns the number of the first edit they differ after,
+  or 0 if they never do. */
+  size_t CheckRelex(const uint8_t *tables, size_t tablesSize, const GPSTR_T &source, bool skipNoise)
+  {
+    Parser relexing, lexing;
+    relexing.LoadTables(tables, tablesSize);
+    lexing.LoadTables(tables, tablesSize);
+    relexing.SkipNoiseRuns = skipNoise;
+    lexing.SkipNoiseRuns = skipNoise;
+
+    // Checkpoints close to each other, so that edits move them around
+    IncrementalLexer relexer(&relexing, 64), lexer(&lexing, 64);
+    GPSTR_T relexed = source, lexed;
+    relexer.Lex(relexed);
+
+    std::vector<Edit> edits = MakeEdits(source, 200);
+    for (size_t e = 0; e < edits.size(); ++e)
+    {
+      relexer.Update(relexed, ApplyEdit(relexed, edits[e]));
+      lexed = relexed;
+      lexer.Lex(lexed);
+
+      if (relexer.Count() != lexer.Count())
+        return e + 1;
+      for (size_t i = 0; i < lexer.Count(); ++i)
+      {
+        const Token &a = *relexer.GetToken(i);
+        const Token &b = *lexer.GetToken(i);
+        if ((a.Parent->TableIndex != b.Parent->TableIndex) || (a.Location.Begin != b.Location.Begin) ||
+          (a.Location.End != b.Location.End) || (a.StringData != b.StringData))
+        {
+          return e + 1;
+        }
+      }
+    }
+
+    return 0;
+  }
+
+  // ===== Phases
+
+  size_t WalkTree(const std::shared_ptr<Reduction> &root)
+  {
+    // Iterative, as trees of long lists are deep
+    size_t nodes = 0;
+    std::vector<const Reduction*> pending(1, root.get());
+    while (!pending.empty())
+    {
+      const Reduction *node = pending.back();
+      pending.pop_back();
+      ++nodes;
+
+      for (size_t i = 0; i < node->Branches.Count(); ++i)
+      {
+        const std::shared_ptr<Token> &branch = node->Branches[i];
+        if (branch->GetType() == Symbol::SymbolType::Nonterminal)
+          pending.push_back(branch->ReductionData.get());
+        else
+          ++nodes;
+      }
+    }
+
+    return nodes;
+  }
+
+#ifdef GOLDCPP_SHARED_TABLES
+  // Reductions made parsing 'source' with 'tables', 0 if it does not parse
+  size_t CountReductions(const std::shared_ptr<const GrammarTables> &tables, const GPSTR_T &source)
+  {
+    Parser parser;
+    parser.UseTables(tables);
+    parser.Open(source);
+    size_t reductions = 0;
+    for (;;)
+    {
+      ParseMessage message = parser.Parse();
+      if (message == ParseMessage::Reduction)
+        ++reductions;
+      else if (message != ParseMessage::TokenRead)
+        return (message == ParseMessage::Accept) ? reductions : 0;
+    }
+  }
+
+  bool MeasureAttach(const std::string &grammar, const uint8_t *egt, size_t egtSize, const GPSTR_T &source, int repeat, bool eliminateUnits)
+  {
+    Parser loader;
+    loader.LoadTables(egt, egtSize);
+    if (eliminateUnits)
+      loader.EliminateUnitProductions();
+    std::shared_ptr<const GrammarTables> loaded = loader.ShareTables();
+
+    std::random_device random;
+    std::string name = "/goldcpp_benchmark_" + grammar + "_" + std::to_string(random());
+    if (!SharedTableSegment::Publish(name.c_str(), *loaded))
+    {
+      std::cerr << grammar << ": cannot publish the tables to shared memory" << std::endl;
+      return false;
+    }
+
+    Report(grammar, egtSize, "attach", Measure(repeat, [&]() -> size_t {
+      std::shared_ptr<const GrammarTables> tables = SharedTableSegment::Attach(name.c_str());
+      return tables ? tables->GetSymbolTable().Count() : 0;
+    }));
+
+    std::shared_ptr<const GrammarTables> attached = SharedTableSegment::Attach(name.c_str());
+    SharedTableSegment::Remove(name.c_str());
+    if (!attached)
+    {
+      std::cerr << grammar << ": cannot attach to the tables in shared memory" << std::endl;
+      return false;
+    }
+    if (CountReductions(attached, source) != CountReductions(loaded, source))
+    {
+      std::cerr << grammar << ": the tables in shared memory parse otherwise than the loaded ones" << std::endl;
+      return false;
+    }
+    return true;
+  }
+#endif
+
+  bool Run(const std::string &grammar, const std::vector<char> &egt, const GPSTR_T &source, int repeat, bool flatten, bool eliminateUnits)
+  {
+    const uint8_t *tables = (const uint8_t*)egt.data();
+    size_t chars = source.size();
+
+    Report(grammar, egt.size(), "load", Measure(repeat, [&]() -> size_t {
+      Parser parser;
+      parser.LoadTables(tables, egt.size());
+      if (eliminateUnits)
+        parser.EliminateUnitProductions();
+      return parser.GetSymbolCount();
+    }));
+#ifdef GOLDCPP_SHARED_TABLES
+    if (!MeasureAttach(grammar, tables, egt.size(), source, repeat, eliminateUnits))
+      return false;
+#endif
+
+    size_t heapBefore = Heap.Live;
+    Parser parser;
+    if (!parser.LoadTables(tables, egt.size()))
+    {
+      std::cerr << grammar << ": cannot load the tables" << std::endl;
+      return false;
+    }
+    if (eliminateUnits)
+      parser.EliminateUnitProductions();
+    ReportTables(grammar, parser.GetTableMemory(), Heap.Live - heapBefore);
+    if (flatten)
+      parser.FlattenLists();
+
+    std::function<void()> restart = [&]() { parser.Restart(); };
+    Report(grammar, chars, "lex", Measure(repeat, restart, [&]() -> size_t {
+      size_t tokens = 0;
+      parser.Open(source);
+      for (;;)
+      {
+        std::shared_ptr<Token> token = parser.ReadToken();
+        ++tokens;
+        Symbol::SymbolType type = token->GetType();
+        if ((type == Symbol::SymbolType::End) || (type == Symbol::SymbolType::Error))
+          break;
+      }
+      return tokens;
+    }));
+
+    GPSTR_T checked = source.substr(0, 10000);
+    for (int skip = 0; skip < 2; ++skip)
+    {
+      size_t failed = CheckRelex(tables, egt.size(), checked, skip != 0);
+      if (failed)
+      {
+        std::cerr << grammar << ": relexing after edit " << failed << (skip ? " with" : " without")
+          << " SkipNoiseRuns gives other tokens than lexing all of the text" << std::endl;
+        return false;
+      }
+    }
+
+    std::vector<Edit> edits = MakeEdits(source, 200);
+    GPSTR_T edited;
+    IncrementalLexer relexer(&parser);
+    Report(grammar, chars, "relex", Measure(repeat, [&]() {
+      edited = source;
+      relexer.Lex(edited);
+    }, [&]() -> size_t {
+      size_t tokens = 0;
+      for (size_t e = 0; e < edits.size(); ++e)
+      {
+        size_t changedBegin, changedEnd;
+        relexer.Update(edited, ApplyEdit(edited, edits[e]), &changedBegin, &changedEnd);
+        tokens += changedEnd - changedBegin;
+      }
+      return tokens;
+    }));
+    parser.Restart();
+
+    bool accepted = false;
+    Report(grammar, chars, "parse", Measure(repeat, restart, [&]() -> size_t {
+      size_t reductions = 0;
+      parser.Open(source);
+      for (;;)
+      {
+        ParseMessage message = parser.Parse();
+        if (message == ParseMessage::Reduction)
+          ++reductions;
+        else if (message != ParseMessage::TokenRead)
+        {
+          accepted = (message == ParseMessage::Accept);
+          break;
+        }
+      }
+      return reductions;
+    }));
+#ifdef GOLDCPP_STATS
+    ReportStats(grammar, chars, parser.GetStats());
+#endif
+    parser.Restart();
+
+    if (!accepted)
+    {
+      std::cerr << grammar << ": the input does not parse" << std::endl;
+      return false;
+    }
+
+    SimpleParser simple(tables, egt.size());
+    if (eliminateUnits)
+      simple.GetParserCore()->EliminateUnitProductions();
+    if (flatten)
+      simple.GetParserCore()->FlattenLists();
+    std::function<void()> release = [&]() {
+      simple.Root.reset();
+      simple.GetParserCore()->Restart();
+    };
+    for (int trim = 0; trim < 2; ++trim)
+    {
+      Report(grammar, chars, trim ? "simple_trim" : "simple", Measure(repeat, release, [&]() -> size_t {
+        GPSTR_T message;
+        simple.Parse(source, message, trim != 0);
+        return simple.Root ? 1 : 0;
+      }));
+
+      Report(grammar, chars, trim ? "walk_trim" : "walk", Measure(repeat, [&]() -> size_t {
+        return WalkTree(simple.Root);
+      }));
+
+      // Only the tree is left once the parser let go of the source and its stack
+      simple.GetParserCore()->Restart();
+      TreeMemory tree = MeasureTree(simple.Root);
+      heapBefore = Heap.Live;
+      simple.Root.reset();
+      ReportTree(grammar, chars, trim ? "tree_trim" : "tree", tree, heapBefore - Heap.Live);
+    }
+
+    return true;
+  }
+
+  bool ReadFile(const std::string &path, std::vector<char> &data)
+  {
+    std::ifstream input(path.c_str(), std::ios::binary);
+    if (!input)
+      return false;
+
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+  }
+
+  GPSTR_T FromUtf8(const std::string &text)
+  {
+    GPSTR_T result;
+#ifdef __GNUC__
+    utf8::utf8to16(text.begin(), text.end(), std::back_inserter(result));
+#else
+    result = text;
+#endif
+    return result;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int repeat = 5;
+  bool flatten = false;
+  bool eliminateUnits = false;
+  std::vector<size_t> sizes;
+  std::vector<std::string> grammars;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((arg == "--repeat") && (i + 1 < argc))
+      repeat = std::max(1, std::atoi(argv[++i]));
+    else if ((arg == "--sizes") && (i + 1 < argc))
+    {
+      std::stringstream list(argv[++i]);
+      std::string size;
+      while (std::getline(list, size, ','))
+        sizes.push_back((size_t)std::atol(size.c_str()));
+    }
+    else if (arg == "--flatten")
+      flatten = true;
+    else if (arg == "--eliminate-units")
+      eliminateUnits = true;
+    else if (arg.find('=') != std::string::npos)
+      grammars.push_back(arg);
+    else
+    {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 2;
+    }
+  }
+
+  if (grammars.empty())
+  {
+    std::cerr << "Usage: benchmark [--repeat N] [--sizes N,N,...] [--flatten] [--eliminate-units] <grammar>=<file.egt>[@<input>] ..." << std::endl;
+    return 2;
+  }
+  if (sizes.empty())
+  {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+  }
+
+  bool ok = true;
+  for (size_t g = 0; g < grammars.size(); ++g)
+  {
+    size_t eq = grammars[g].find('=');
+    size_t at = grammars[g].find('@', eq);
+    std::string name = grammars[g].substr(0, eq);
+    std::string egtPath = grammars[g].substr(eq + 1, (at == std::string::npos) ? std::string::npos : at - eq - 1);
+
+    std::vector<char> egt;
+    if (!ReadFile(egtPath, egt))
+    {
+      std::cerr << "Cannot read " << egtPath << std::endl;
+      ok = false;
+      continue;
+    }
+
+    if (at != std::string::npos)
+    {
+      std::vector<char> input;
+      if (!ReadFile(grammars[g].substr(at + 1), input))
+      {
+        std::cerr << "Cannot read " << grammars[g].substr(at + 1) << std::endl;
+        ok = false;
+        continue;
+      }
+      ok = Run(name, egt, FromUtf8(std::string(input.begin(), input.end())), repeat, flatten, eliminateUnits) && ok;
+      continue;
+    }
+
+    if (MakeInput(name, 1).empty())
+    {
+      std::cerr << "No input generator for " << name << ", give an input file after '@'" << std::endl;
+      ok = false;
+      continue;
+    }
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+      ok = Run(name, egt, FromUtf8(MakeInput(name, sizes[s])), repeat, flatten, eliminateUnits) && ok;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "CharScan.h"
+#include <limits>
+#include <type_traits>
+
+// Only where the compiler targets SSE2, unless turned off, see CharScan.h
+#if !defined(GOLDCPP_NO_SIMD_SCAN) && defined(__GNUC__) && (defined(__SSE2__) || defined(__AVX2__))
+  #include <immintrin.h>
+  #define GOLDCPP_HAVE_SIMD_SCAN
+#endif
+
+namespace GoldCPP
+{
+  typedef std::make_unsigned<GPCHR_T>::type UCHR_T;
+
+  bool SimpleCharSet::Assign(const CharacterSet &set)
+  {
+    RangeCount_ = 0;
+
+    if (set.Count() > kMaxRanges)
+      return false;
+
+    for (size_t i = 0; i < set.Count(); ++i)
+    {
+      const CharacterRange &range = set[i];
+      if ((range.End < range.Start) || (range.End > std::numeric_limits<UCHR_T>::max()))
+      {
+        RangeCount_ = 0;
+        return false;
+      }
+
+      Start_[i] = (uint16_t)range.Start;
+      Length_[i] = (uint16_t)(range.End - range.Start);
+    }
+
+    RangeCount_ = set.Count();
+    return true;
+  }
+
+  bool SimpleCharSet::Contains(GPCHR_T c) const
+  {
+    uint16_t code = (uint16_t)(UCHR_T)c;
+    for (size_t i = 0; i < RangeCount_; ++i)
+    {
+      if ((uint16_t)(code - Start_[i]) <= Length_[i])
+        return true;
+    }
+
+    return false;
+  }
+
+  size_t SimpleCharSet::SpanLength(const GPCHR_T *str, size_t len) const
+  {
+    return Scan(str, len, false);
+  }
+
+  size_t SimpleCharSet::FindFirst(const GPCHR_T *str, size_t len) const
+  {
+    return Scan(str, len, true);
+  }
+
+  size_t SimpleCharSet::Scan(const GPCHR_T *str, size_t len, bool stopOnMember) const
+  {
+    size_t pos = 0;
+
+#ifdef GOLDCPP_HAVE_SIMD_SCAN
+    /* With 16-bit characters, 'c' is in [Start, Start+Length] exactly when
+    the wrapping difference (c - Start) saturated-subtracted by Length is 0.
+    The membership mask is inverted if we are looking for the first
+    non-member, so that we can always stop at the first set bit. */
+    static_assert(sizeof(GPCHR_T) == 2, "SIMD scanning requires 16-bit characters");
+
+  #ifdef __AVX2__
+    {
+      __m256i starts[kMaxRanges], lengths[kMaxRanges];
+      for (size_t r = 0; r < RangeCount_; ++r)
+      {
+        starts[r] = _mm256_set1_epi16((short)Start_[r]);
+        lengths[r] = _mm256_set1_epi16((short)Length_[r]);
+      }
+
+      const __m256i zero = _mm256_setzero_si256();
+      const uint32_t flip = stopOnMember ? 0 : 0xFFFFFFFFu;
+      for (; pos + 16 <= len; pos += 16)
+      {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(str + pos));
+        __m256i member = zero;
+        for (size_t r = 0; r < RangeCount_; ++r)
+        {
+          __m256i offs = _mm256_subs_epu16(_mm256_sub_epi16(chars, starts[r]), lengths[r]);
+          member = _mm256_or_si256(member, _mm256_cmpeq_epi16(offs, zero));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(member) ^ flip;
+        if (mask != 0)
+          return pos + __builtin_ctz(mask) / 2;
+      }
+    }
+  #endif
+
+    {
+      __m128i starts[kMaxRanges], lengths[kMaxRanges];
+      for (size_t r = 0; r < RangeCount_; ++r)
+      {
+        starts[r] = _mm_set1_epi16((short)Start_[r]);
+        lengths[r] = _mm_set1_epi16((short)Length_[r]);
+      }
+
+      const __m128i zero = _mm_setzero_si128();
+      const uint32_t flip = stopOnMember ? 0 : 0xFFFFu;
+      for (; pos + 8 <= len; pos += 8)
+      {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(str + pos));
+        __m128i member = zero;
+        for (size_t r = 0; r < RangeCount_; ++r)
+        {
+          __m128i offs = _mm_subs_epu16(_mm_sub_epi16(chars, starts[r]), lengths[r]);
+          member = _mm_or_si128(member, _mm_cmpeq_epi16(offs, zero));
+        }
+
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(member) ^ flip;
+        if (mask != 0)
+          return pos + __builtin_ctz(mask) / 2;
+      }
+    }
+#endif
+
+    // Scalar fallback, also handles the tail of the SIMD loops
+    while ((pos < len) && (Contains(str[pos]) != stopOnMember))
+      ++pos;
+
+    return pos;
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef GOLDCPP_CHARSCAN_H
+#define GOLDCPP_CHARSCAN_H
+
+#include "String.h"
+#include "CharacterSet.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace GoldCPP
+{
+  /* A character set made of only a few ranges, in a form that can be
+  tested against whole runs of input text at once. Under GCC/Clang on x86
+  the tests use SSE2 (or AVX2 if enabled at compile time), otherwise they
+  fall back to plain loops. Define GOLDCPP_NO_SIMD_SCAN to use the plain
+  loops everywhere. */
+  class SimpleCharSet
+  {
+  public:
+    static const size_t kMaxRanges = 4;
+
+  private:
+    uint16_t Start_[kMaxRanges];
+    uint16_t Length_[kMaxRanges];   // End - Start
+    size_t RangeCount_;
+
+  public:
+
+    SimpleCharSet() :
+      RangeCount_(0)
+    {}
+
+    /* Takes over the ranges of 'set'. Returns false (and leaves this set
+    empty) if 'set' has too many ranges or has characters outside of the
+    range representable by GPCHR_T. */
+    bool Assign(const CharacterSet &set);
+
+    bool Contains(GPCHR_T c) const;
+
+    /* Returns the number of leading characters in 'str' that are members
+    of this set. 'len' is the number of readable characters in 'str'. */
+    size_t SpanLength(const GPCHR_T *str, size_t len) const;
+
+    /* Returns the index of the first character in 'str' that is a member
+    of this set, or 'len' if there is none. Like memchr() for several
+    characters at once. */
+    size_t FindFirst(const GPCHR_T *str, size_t len) const;
+
+  private:
+
+    size_t Scan(const GPCHR_T *str, size_t len, bool stopOnMember) const;
+  };
+}
+
+#endif // GOLDCPP_CHARSCAN_H
@@ -20,4 +20,24 @@ namespace GoldCPP
 
     return false;
   }
+
+  bool CharacterSet::operator==(const CharacterSet &other) const
+  {
+    if (this == &other)
+      return true;
+
+    size_t numItems = Count();
+    if (numItems != other.Count())
+      return false;
+
+    for (size_t i = 0; i < numItems; ++i)
+    {
+      const CharacterRange &a = GetItemAt(i);
+      const CharacterRange &b = other.GetItemAt(i);
+      if ((a.Start != b.Start) || (a.End != b.End))
+        return false;
+    }
+
+    return true;
+  }
 }
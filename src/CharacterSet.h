@@ -12,6 +12,7 @@ namespace GoldCPP
 
     CharacterSet(size_t initSize = 0);
     bool Contains(uint32_t c) const;
+    bool operator==(const CharacterSet &other) const;
   };
 
   typedef Vector<CharacterSet> CharacterSetList;
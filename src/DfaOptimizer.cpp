@@ -0,0 +1,369 @@
+#include "DfaOptimizer.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace GoldCPP
+{
+  static bool RangeStartsBefore(const CharacterRange &a, const CharacterRange &b)
+  {
+    return a.Start < b.Start;
+  }
+
+  namespace
+  {
+    struct CountLarger
+    {
+      const std::vector<uint64_t> *Counts;
+
+      bool operator()(uint16_t a, uint16_t b) const
+      {
+        return (*Counts)[a] > (*Counts)[b];
+      }
+    };
+  }
+
+  DfaOptimizer::DfaOptimizer(FaStateList &dfa, CharacterSetList &charSets) :
+    DFA_(dfa), CharSets_(charSets)
+  {}
+
+  size_t DfaOptimizer::Minimize()
+  {
+    size_t numStates = DFA_.Count();
+    if (numStates == 0)
+      return 0;
+
+    // Only states reachable from the initial state are kept
+    std::vector<bool> reachable(numStates, false);
+    std::vector<uint16_t> pending(1, DFA_.InitialState);
+    reachable[DFA_.InitialState] = true;
+    while (!pending.empty())
+    {
+      uint16_t state = pending.back();
+      pending.pop_back();
+      const FaEdgeList &edges = DFA_[state].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+      {
+        if (!reachable[edges[n].Target])
+        {
+          reachable[edges[n].Target] = true;
+          pending.push_back(edges[n].Target);
+        }
+      }
+    }
+
+    /* Split the characters into classes that no character set tells apart,
+    so that states can be compared by their target for each class. Class k
+    starts at bounds[k] and ends before bounds[k+1]. */
+    std::vector<uint32_t> bounds;
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      const FaEdgeList &edges = DFA_[i].Edges;
+      for (size_t n = 0; reachable[i] && (n < edges.Count()); ++n)
+      {
+        const CharacterSet &chars = *(edges[n].Characters);
+        for (size_t r = 0; r < chars.Count(); ++r)
+        {
+          bounds.push_back(chars[r].Start);
+          bounds.push_back(chars[r].End + 1);
+        }
+      }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    size_t numClasses = bounds.empty() ? 0 : bounds.size() - 1;
+
+    std::vector<int> targets(numStates * numClasses, -1);
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      const FaEdgeList &edges = DFA_[i].Edges;
+      for (size_t n = 0; reachable[i] && (n < edges.Count()); ++n)
+      {
+        const CharacterSet &chars = *(edges[n].Characters);
+        for (size_t r = 0; r < chars.Count(); ++r)
+        {
+          size_t k = std::lower_bound(bounds.begin(), bounds.end(), chars[r].Start) - bounds.begin();
+          for (; (k < numClasses) && (bounds[k] <= chars[r].End); ++k)
+            targets[i*numClasses + k] = edges[n].Target;
+        }
+      }
+    }
+
+    // Start with one block per accepted symbol, and split blocks until all their states agree
+    std::vector<int> block(numStates, -1);
+    size_t numBlocks = 0;
+    {
+      std::map<const Symbol*, int> byAccept;
+      for (size_t i = 0; i < numStates; ++i)
+      {
+        if (!reachable[i])
+          continue;
+
+        std::map<const Symbol*, int>::const_iterator it = byAccept.find(DFA_[i].Accept);
+        if (it == byAccept.end())
+          it = byAccept.insert(std::make_pair(DFA_[i].Accept, (int)byAccept.size())).first;
+        block[i] = it->second;
+      }
+      numBlocks = byAccept.size();
+    }
+
+    std::vector<int> key(numClasses + 1);
+    std::vector<int> next(numStates, -1);
+    for (;;)
+    {
+      std::map<std::vector<int>, int> split;
+      for (size_t i = 0; i < numStates; ++i)
+      {
+        if (!reachable[i])
+          continue;
+
+        key[0] = block[i];
+        for (size_t k = 0; k < numClasses; ++k)
+        {
+          int target = targets[i*numClasses + k];
+          key[k+1] = (target < 0) ? -1 : block[target];
+        }
+
+        std::map<std::vector<int>, int>::const_iterator it = split.find(key);
+        if (it == split.end())
+          it = split.insert(std::make_pair(key, (int)split.size())).first;
+        next[i] = it->second;
+      }
+
+      block.swap(next);
+      if (split.size() == numBlocks)
+        break;
+      numBlocks = split.size();
+    }
+
+    // Blocks become states in the order of their first state, which stands for the whole block
+    std::vector<int> newIndex(numBlocks, -1);
+    std::vector<uint16_t> representative;
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      if (reachable[i] && (newIndex[block[i]] < 0))
+      {
+        newIndex[block[i]] = (int)representative.size();
+        representative.push_back((uint16_t)i);
+      }
+    }
+
+    /* Edges of a representative that now lead to the same state are merged.
+    New character sets are added to the table for that, so edges are kept
+    as table indexes until it is complete. */
+    CharacterSetList charSets = CharSets_;
+    std::vector<std::vector<std::pair<size_t, uint16_t>>> newEdges(representative.size());
+    for (size_t s = 0; s < representative.size(); ++s)
+    {
+      const FaEdgeList &edges = DFA_[representative[s]].Edges;
+      std::vector<std::vector<size_t>> merged;
+      std::vector<uint16_t> mergedTargets;
+      for (size_t n = 0; n < edges.Count(); ++n)
+      {
+        uint16_t target = (uint16_t)newIndex[block[edges[n].Target]];
+        size_t setIndex = (size_t)(edges[n].Characters - &CharSets_[0]);
+        size_t m = std::find(mergedTargets.begin(), mergedTargets.end(), target) - mergedTargets.begin();
+        if (m == mergedTargets.size())
+        {
+          mergedTargets.push_back(target);
+          merged.push_back(std::vector<size_t>());
+        }
+        merged[m].push_back(setIndex);
+      }
+
+      for (size_t m = 0; m < merged.size(); ++m)
+      {
+        if (merged[m].size() == 1)
+        {
+          newEdges[s].push_back(std::make_pair(merged[m][0], mergedTargets[m]));
+          continue;
+        }
+
+        std::vector<CharacterRange> ranges;
+        for (size_t e = 0; e < merged[m].size(); ++e)
+        {
+          const CharacterSet &chars = CharSets_[merged[m][e]];
+          for (size_t r = 0; r < chars.Count(); ++r)
+            ranges.push_back(chars[r]);
+        }
+        std::sort(ranges.begin(), ranges.end(), RangeStartsBefore);
+
+        CharacterSet united;
+        for (size_t r = 0; r < ranges.size(); ++r)
+        {
+          if ((united.Count() > 0) && (ranges[r].Start <= united[united.Count()-1].End + 1))
+            united[united.Count()-1].End = std::max(united[united.Count()-1].End, ranges[r].End);
+          else
+            united.Add(ranges[r]);
+        }
+
+        newEdges[s].push_back(std::make_pair(charSets.Count(), mergedTargets[m]));
+        charSets.Add(united);
+      }
+    }
+
+    CharSets_ = charSets;
+
+    FaStateList dfa(representative.size());
+    dfa.InitialState = (uint16_t)newIndex[block[DFA_.InitialState]];
+    dfa.ErrorSymbol = DFA_.ErrorSymbol;
+    for (size_t s = 0; s < representative.size(); ++s)
+    {
+      dfa[s] = FaState(DFA_[representative[s]].Accept);
+      dfa[s].Edges.Reserve(newEdges[s].size());
+      for (size_t e = 0; e < newEdges[s].size(); ++e)
+        dfa[s].Edges.Add(FaEdge(&CharSets_[newEdges[s][e].first], newEdges[s][e].second));
+    }
+
+    DFA_ = dfa;
+    return DFA_.Count();
+  }
+
+  size_t DfaOptimizer::MergeCharacterSets()
+  {
+    CharacterSetList charSets;
+    std::map<std::vector<uint32_t>, size_t> index;
+    std::vector<size_t> newIndex(CharSets_.Count(), INVALID_IDX);
+    std::vector<std::vector<size_t>> oldIndex(DFA_.Count());    // Of each edge's set
+    std::vector<uint32_t> key;
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      const FaEdgeList &edges = DFA_[i].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+      {
+        size_t setIndex = (size_t)(edges[n].Characters - &CharSets_[0]);
+        oldIndex[i].push_back(setIndex);
+        if (newIndex[setIndex] != INVALID_IDX)
+          continue;
+
+        const CharacterSet &chars = CharSets_[setIndex];
+        key.clear();
+        for (size_t r = 0; r < chars.Count(); ++r)
+        {
+          key.push_back(chars[r].Start);
+          key.push_back(chars[r].End);
+        }
+
+        std::map<std::vector<uint32_t>, size_t>::const_iterator it = index.find(key);
+        if (it == index.end())
+        {
+          it = index.insert(std::make_pair(key, charSets.Count())).first;
+          charSets.Add(chars);
+        }
+        newIndex[setIndex] = it->second;
+      }
+    }
+
+    // The old sets go away, so edges are rewired by index
+    CharSets_ = charSets;
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      FaEdgeList &edges = DFA_[i].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+        edges[n].Characters = &CharSets_[newIndex[oldIndex[i][n]]];
+    }
+
+    return CharSets_.Count();
+  }
+
+  void DfaOptimizer::Reorder()
+  {
+    size_t numStates = DFA_.Count();
+    if (numStates == 0)
+      return;
+
+    std::vector<uint16_t> order(1, DFA_.InitialState);
+    std::vector<bool> seen(numStates, false);
+    seen[DFA_.InitialState] = true;
+    for (size_t next = 0; next < order.size(); ++next)
+    {
+      const FaEdgeList &edges = DFA_[order[next]].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+      {
+        if (!seen[edges[n].Target])
+        {
+          seen[edges[n].Target] = true;
+          order.push_back(edges[n].Target);
+        }
+      }
+    }
+
+    // States that cannot be reached go last
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      if (!seen[i])
+        order.push_back((uint16_t)i);
+    }
+
+    Renumber(order);
+  }
+
+  void DfaOptimizer::Reorder(const std::vector<uint64_t> &stateCounts)
+  {
+    std::vector<uint16_t> order(DFA_.Count());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = (uint16_t)i;
+
+    CountLarger larger = { &stateCounts };
+    std::stable_sort(order.begin(), order.end(), larger);
+    Renumber(order);
+  }
+
+  void DfaOptimizer::SortEdges(const std::vector<std::vector<uint64_t>> &edgeCounts)
+  {
+    // Edges of a state never overlap, so their order does not matter to the tokens
+    std::vector<uint16_t> order;
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      FaEdgeList &edges = DFA_[i].Edges;
+      order.resize(edges.Count());
+      for (size_t n = 0; n < order.size(); ++n)
+        order[n] = (uint16_t)n;
+
+      CountLarger larger = { &edgeCounts[i] };
+      std::stable_sort(order.begin(), order.end(), larger);
+
+      FaEdgeList sorted;
+      sorted.Reserve(edges.Count());
+      for (size_t n = 0; n < order.size(); ++n)
+        sorted.Add(edges[order[n]]);
+      edges = sorted;
+    }
+  }
+
+  void DfaOptimizer::Renumber(const std::vector<uint16_t> &order)
+  {
+    size_t numStates = DFA_.Count();
+    std::vector<uint16_t> newIndex(numStates);
+    for (size_t s = 0; s < numStates; ++s)
+      newIndex[order[s]] = (uint16_t)s;
+
+    FaStateList dfa(numStates);
+    dfa.InitialState = newIndex[DFA_.InitialState];
+    dfa.ErrorSymbol = DFA_.ErrorSymbol;
+    for (size_t s = 0; s < numStates; ++s)
+    {
+      dfa[s] = DFA_[order[s]];
+      FaEdgeList &edges = dfa[s].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+        edges[n].Target = newIndex[edges[n].Target];
+    }
+
+    DFA_ = dfa;
+  }
+
+  DfaStats DfaOptimizer::Measure(const FaStateList &dfa, const CharacterSetList &charSets)
+  {
+    DfaStats stats;
+    stats.States = dfa.Count();
+    for (size_t i = 0; i < dfa.Count(); ++i)
+      stats.Edges += dfa[i].Edges.Count();
+    stats.CharacterSets = charSets.Count();
+    for (size_t i = 0; i < charSets.Count(); ++i)
+      stats.Ranges += charSets[i].Count();
+
+    stats.Bytes = stats.States*sizeof(FaState) + stats.Edges*sizeof(FaEdge) +
+      stats.CharacterSets*sizeof(CharacterSet) + stats.Ranges*sizeof(CharacterRange);
+    return stats;
+  }
+}
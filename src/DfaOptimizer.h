@@ -0,0 +1,74 @@
+#ifndef GOLDCPP_DFAOPTIMIZER_H
+#define GOLDCPP_DFAOPTIMIZER_H
+
+#include "FaState.h"
+#include "CharacterSet.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Size of a DFA and its character sets. */
+  struct DfaStats
+  {
+    size_t States;
+    size_t Edges;
+    size_t CharacterSets;
+    size_t Ranges;
+    size_t Bytes;         // Of the table entries, not counting allocator overhead
+
+    DfaStats() :
+      States(0), Edges(0), CharacterSets(0), Ranges(0), Bytes(0)
+    {}
+  };
+
+  /* Rewrites a DFA and its character sets in place, without changing the
+  tokens it produces. Edges are pointers into the character set table, which
+  may be replaced, so anything else pointing into either table must be
+  derived again afterwards. */
+  class DfaOptimizer
+  {
+  private:
+    FaStateList &DFA_;
+    CharacterSetList &CharSets_;
+
+#ifndef __GNUC__
+    DfaOptimizer(const DfaOptimizer& that){}
+#else
+    DfaOptimizer(const DfaOptimizer& that) = delete;
+#endif
+
+    /* Moves state order[s] to index s. */
+    void Renumber(const std::vector<uint16_t> &order);
+
+  public:
+
+    DfaOptimizer(FaStateList &dfa, CharacterSetList &charSets);
+
+    /* Merges states that accept the same symbol and move to equivalent states
+    on every character, and drops states that cannot be reached. Edges that
+    lead to the same state are merged into one. Returns the number of states. */
+    size_t Minimize();
+
+    /* Makes edges with equal character sets share one set, and drops the sets
+    no edge uses. Returns the number of sets. */
+    size_t MergeCharacterSets();
+
+    /* Numbers the states in the order a breadth-first walk from the initial
+    state reaches them, so that the states near the start of a token, which
+    are used the most, are next to each other. The initial state becomes 0. */
+    void Reorder();
+
+    /* Numbers the states by descending count, such as of their visits. */
+    void Reorder(const std::vector<uint64_t> &stateCounts);
+
+    /* Sorts the edges of each state by descending count, so the DFA finds
+    the edges taken most often first. Counts are given per state. */
+    void SortEdges(const std::vector<std::vector<uint64_t>> &edgeCounts);
+
+    static DfaStats Measure(const FaStateList &dfa, const CharacterSetList &charSets);
+  };
+}
+
+#endif // GOLDCPP_DFAOPTIMIZER_H
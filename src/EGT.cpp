@@ -2,182 +2,284 @@
 
 namespace GoldCPP
 {
-  const char EgtReader::kRecordContentMulti_ = 'M';
+  static const char kRecordContentMulti = 'M';
 
-  static size_t FindStringLengthU16(const uint8_t* buff, size_t buffLen, size_t pos)
+  EgtReader::EgtReader(const uint8_t* input, size_t inputLen) :
+      InputPos_(0),
+      InputLen_(inputLen),
+      Input_(input),
+      EntryCount_(0),
+      EntriesRead_(0),
+      Record_(0),
+      Error_()
   {
-    const uint16_t *buffEnd = (const uint16_t *)(buff + buffLen);
-    const uint16_t *strBuff = (const uint16_t *)(buff + pos);
+    GPSTR_T header;
+    if (RawReadCString(&header) && (header != GPSTR_C("GOLD Parser Tables/v5.0")))
+      Fail(EgtErrorCode::BadHeader);
+  }
 
-    for (size_t strLen = 0; strBuff < buffEnd; ++strLen)
+  bool EgtReader::Fail(EgtErrorCode code)
+  {
+    if (!Failed())
     {
-      if (*strBuff++ == 0)
-        return strLen;
+      Error_.Code = code;
+      Error_.Offset = InputPos_;
+      Error_.Record = Record_;
     }
-
-    assert (false);
-    return (uint16_t)-1;
+    return false;
   }
 
-  GPSTR_T EgtReader::RawReadCString()
+  bool EgtReader::RawReadCString(GPSTR_T *out)
   {
-    // First, find out the length of the string
-    size_t len = FindStringLengthU16(Input_, InputLen_, InputPos_);
-
-    // Reserve buffer
-    uint16_t *u16text = new uint16_t[len];
-
-    // Read string
-    for (size_t i = 0; i < len; ++i)
-      u16text[i] = RawReadUInt16();
-    RawReadUInt16();    // skip terminating null in input stream
+    /* Decodes up to the terminating null in one pass. Characters outside of
+    the BMP are kept as the surrogate pairs they are stored as, which is right
+    for UTF-16 strings. */
+    if (out)
+      out->clear();
 
-    // Convert to target encoding
-    GPSTR_T text(len, ' ');
-    for (size_t i = 0; i < len; ++i)
+    for (size_t pos = InputPos_; pos + 1 < InputLen_; pos += 2)
     {
-      // Replace this check with proper Unicode conversion.
-      // Until that is done, we only support the BMP.
-      assert((u16text[i] < 0xD800) || (u16text[i] > 0xDBFF));
+      uint16_t c = (uint16_t)(Input_[pos] | (Input_[pos + 1] << 8));
+      if (c == 0)
+      {
+        InputPos_ = pos + 2;
+        return true;
+      }
 
-      text[i] = (GPCHR_T)(u16text[i]);
+      if (out)
+        out->push_back((GPCHR_T)c);
     }
 
-    // Clean up
-    delete [] u16text;
-
-    // Finished
-    return text;
+    return Fail(EgtErrorCode::Truncated);
   }
 
-  uint8_t EgtReader::ReadByte()
+  bool EgtReader::RawReadUInt16(uint16_t &value)
   {
-    return Input_[InputPos_++];
+    if (InputLen_ - InputPos_ < 2)
+    {
+      value = 0;
+      return Fail(EgtErrorCode::Truncated);
+    }
+
+    // Little endian, whatever the platform is
+    value = (uint16_t)(Input_[InputPos_] | (Input_[InputPos_ + 1] << 8));
+    InputPos_ += 2;
+    return true;
   }
 
-  uint16_t EgtReader::RawReadUInt16()
+  bool EgtReader::BeginEntry(EntryType type)
   {
-    // Read a uint16 in little endian.
-    // Byte order can change depending on platform.
+    if (Failed())
+      return false;
+    if (RecordComplete())
+      return Fail(EgtErrorCode::BadRecord);
+    if (EofReached())
+      return Fail(EgtErrorCode::Truncated);
+    if ((EntryType)Input_[InputPos_] != type)
+      return Fail(EgtErrorCode::WrongEntryType);
 
-    // Least significant byte first
-    uint16_t b0 = ReadByte(); assert(!EofReached());
-    uint16_t b1 = ReadByte();
-    return (uint16_t)((b1 << 8) + b0);
+    ++InputPos_;
+    ++EntriesRead_;
+    return true;
   }
 
-  EgtReader::EgtReader(const uint8_t* input, size_t inputLen) :
-      InputPos_(0),
-      InputLen_(inputLen),
-      Input_(input),
-      EntryCount_(0),
-      EntriesRead_(0)
+  bool EgtReader::GetNextRecord()
   {
-    FileHeader_ = RawReadCString();
+    // Finish current record
+    while (!RecordComplete())
+    {
+      if (!SkipEntry())
+        return false;
+    }
+
+    Record_ = 0;
+    if (Failed() || EofReached())
+      return false;
+
+    // Start next record
+    if (Input_[InputPos_] != kRecordContentMulti)
+      return Fail(EgtErrorCode::BadRecord);
+    ++InputPos_;
+
+    uint16_t count;
+    uint8_t type;
+    if (!RawReadUInt16(count))
+      return false;
+    EntryCount_ = count;
+    EntriesRead_ = 0;
+    if (!RetrieveByte(type))
+      return false;
+
+    Record_ = (char)type;
+    return true;
   }
 
-  Entry EgtReader::RetrieveEntry()
+  bool EgtReader::RetrieveString(GPSTR_T &value)
   {
-    if (RecordComplete())
+    if (!BeginEntry(EntryType::String))
     {
-      return Entry();
+      value.clear();
+      return false;
     }
-    else
-    {
-      ++EntriesRead_;
-      uint8_t type = ReadByte();
 
-      switch (type)
-      {
-      case 'E':
-        return Entry();
-      case 'I':
-        return Entry(RawReadUInt16());
-      case 'S':
-        return Entry(RawReadCString());
-      case 'B':
-        return Entry(ReadByte() != 0);
-      case 'b':
-        return Entry(ReadByte());
-      default:
-        return Entry(EntryType::Error);
-      }
-    }
+    return RawReadCString(&value);
   }
 
-  bool EgtReader::GetNextRecord()
+  bool EgtReader::RetrieveInt16(uint16_t &value)
   {
-      // Finish current record
-      while (EntriesRead_ < EntryCount_)
-        RetrieveEntry();
+    if (!BeginEntry(EntryType::UInt16))
+    {
+      value = 0;
+      return false;
+    }
 
-      // Start next record
-      if (ReadByte() == kRecordContentMulti_)
-      {
-        EntryCount_ = RawReadUInt16();
-        EntriesRead_ = 0;
-        return true;
-      }
-      else
-      {
-        return false;
-      }
+    return RawReadUInt16(value);
   }
 
-  GPSTR_T EgtReader::RetrieveString(bool *success)
+  bool EgtReader::RetrieveBoolean(bool &value)
   {
-    Entry e = RetrieveEntry();
-    if (e.Type == EntryType::String)
-    {
-      if (success) *success = true;
-      return GPSTR_T(e.val_string);
-    }
-    else if (success)
-      *success = false;
+    value = false;
+    if (!BeginEntry(EntryType::Boolean))
+      return false;
+    if (EofReached())
+      return Fail(EgtErrorCode::Truncated);
 
-    return GPSTR_T();
+    value = (Input_[InputPos_++] != 0);
+    return true;
   }
 
+  bool EgtReader::RetrieveByte(uint8_t &value)
+  {
+    value = 0;
+    if (!BeginEntry(EntryType::Byte))
+      return false;
+    if (EofReached())
+      return Fail(EgtErrorCode::Truncated);
+
+    value = Input_[InputPos_++];
+    return true;
+  }
 
-  uint16_t EgtReader::RetrieveInt16(bool *success)
+  bool EgtReader::RetrieveIndex(uint16_t &value, size_t count)
   {
-    Entry e = RetrieveEntry();
-    if (e.Type == EntryType::UInt16)
+    if (!RetrieveInt16(value))
+      return false;
+    if (value >= count)
     {
-      if (success) *success = true;
-      return e.val_uint16;
+      Fail(EgtErrorCode::BadIndex);
+      Error_.Offset = InputPos_ - 2;    // Of the index
+      value = 0;
+      return false;
     }
-    else if (success)
-      *success = false;
 
-    return 0;
+    return true;
   }
 
-  bool EgtReader::RetrieveBoolean(bool *success)
+  bool EgtReader::SkipEntry()
   {
-    Entry e = RetrieveEntry();
-    if (e.Type == EntryType::Boolean)
+    if (Failed())
+      return false;
+    if (RecordComplete())
+      return Fail(EgtErrorCode::BadRecord);
+    if (EofReached())
+      return Fail(EgtErrorCode::Truncated);
+
+    EntryType type = (EntryType)Input_[InputPos_++];
+    ++EntriesRead_;
+
+    size_t size;
+    switch (type)
     {
-      if (success) *success = true;
-      return e.val_bool;
+    case EntryType::Empty:
+      return true;
+    case EntryType::UInt16:
+      size = 2;
+      break;
+    case EntryType::String:
+      return RawReadCString(NULL);
+    case EntryType::Boolean:
+    case EntryType::Byte:
+      size = 1;
+      break;
+    default:
+      --InputPos_;
+      return Fail(EgtErrorCode::WrongEntryType);
     }
-    else if (success)
-      *success = false;
 
-    return false;
+    if (InputLen_ - InputPos_ < size)
+      return Fail(EgtErrorCode::Truncated);
+    InputPos_ += size;
+    return true;
   }
 
-  uint8_t EgtReader::RetrieveByte(bool *success)
+  EgtWriter::EgtWriter(std::vector<uint8_t> &out) :
+    Out_(out), CountPos_(0), EntryCount_(0), Overflow_(false)
   {
-    Entry e = RetrieveEntry();
-    if (e.Type == EntryType::Byte)
-    {
-      if (success) *success = true;
-      return e.val_byte;
-    }
-    else if (success)
-      *success = false;
+    RawWriteCString(GPSTR_C("GOLD Parser Tables/v5.0"));
+  }
+
+  void EgtWriter::RawWriteCString(const GPSTR_T &value)
+  {
+    for (size_t i = 0; i < value.size(); ++i)
+      RawWriteUInt16((uint16_t)value[i]);
+    RawWriteUInt16(0);
+  }
+
+  void EgtWriter::RawWriteUInt16(uint16_t value)
+  {
+    Out_.push_back((uint8_t)(value & 0xFF));
+    Out_.push_back((uint8_t)(value >> 8));
+  }
+
+  void EgtWriter::BeginRecord(char type)
+  {
+    Out_.push_back((uint8_t)kRecordContentMulti);
+    CountPos_ = Out_.size();
+    RawWriteUInt16(0);
+    EntryCount_ = 0;
+    AddByte((uint8_t)type);
+  }
+
+  void EgtWriter::EndRecord()
+  {
+    if (EntryCount_ > UINT16_MAX)
+      Overflow_ = true;
+
+    Out_[CountPos_] = (uint8_t)(EntryCount_ & 0xFF);
+    Out_[CountPos_ + 1] = (uint8_t)((EntryCount_ >> 8) & 0xFF);
+  }
+
+  void EgtWriter::AddString(const GPSTR_T &value)
+  {
+    Out_.push_back((uint8_t)EntryType::String);
+    RawWriteCString(value);
+    ++EntryCount_;
+  }
 
-    return 0;
+  void EgtWriter::AddInt16(uint16_t value)
+  {
+    Out_.push_back((uint8_t)EntryType::UInt16);
+    RawWriteUInt16(value);
+    ++EntryCount_;
+  }
+
+  void EgtWriter::AddBoolean(bool value)
+  {
+    Out_.push_back((uint8_t)EntryType::Boolean);
+    Out_.push_back(value ? 1 : 0);
+    ++EntryCount_;
+  }
+
+  void EgtWriter::AddByte(uint8_t value)
+  {
+    Out_.push_back((uint8_t)EntryType::Byte);
+    Out_.push_back(value);
+    ++EntryCount_;
+  }
+
+  void EgtWriter::AddEmpty()
+  {
+    Out_.push_back((uint8_t)EntryType::Empty);
+    ++EntryCount_;
   }
 }
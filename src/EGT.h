@@ -2,8 +2,9 @@
 #define GOLDCPP_EGT_H
 
 #include "String.h"
+#include <vector>
 #include <cstdint>
-#include <cassert>
+#include <cstddef>
 
 namespace GoldCPP
 {
@@ -17,60 +18,49 @@ namespace GoldCPP
     Error = 0
   };
 
-  // Entry is probably worth its own header
-  struct Entry   // used to be 'Entry' class in reference implementation
+  enum class EgtErrorCode
   {
-    const EntryType Type;
-
-    GPSTR_T val_string;
-    union
-    {
-      uint16_t val_uint16;
-      uint8_t val_byte;
-      bool val_bool;
-    };
-
-    Entry(EntryType type) :
-      Type(type)
-    {}
-
-    Entry() :
-      Type(EntryType::Empty)
-    {}
-
-    Entry(uint16_t val) :
-      Type(EntryType::UInt16), val_uint16(val)
-    {}
-
-    Entry(const GPSTR_T &str) :
-      Type(EntryType::String), val_string(str)
-    {}
+    None = 0,
+    Truncated = 1,        // The data ends inside a record or string
+    BadHeader = 2,        // Not an EGT file of version 5.0
+    BadRecord = 3,        // A record does not start like one, has fewer entries than its type needs, or does not fit the others
+    WrongEntryType = 4,   // An entry has another type than the record type needs there
+    UnknownRecord = 5,
+    BadIndex = 6,         // An index is out of the range of its table, or a count does not match
+    MissingItem = 7       // An item of a table was never defined
+  };
 
-    Entry(bool val) :
-      Type(EntryType::Boolean), val_bool(val)
-    {}
+  /* Why tables could not be loaded, see Parser::GetLoadError(). */
+  struct EgtError
+  {
+    EgtErrorCode Code;
+    size_t Offset;        // In the EGT data, where the problem was found
+    char Record;          // Type of the record read then (see EgtReader::EgtRecord), 0 if none
 
-    Entry(uint8_t val) :
-      Type(EntryType::Byte), val_byte(val)
+    EgtError() :
+      Code(EgtErrorCode::None), Offset(0), Record(0)
     {}
   };
 
+  /* Reads the records of an EGT file and the entries in them, checking each
+  against the data left, the entries left in the record, and the entry type
+  expected. Entries are decoded straight from the input. After the first
+  problem, which GetError() tells about, every read fails. */
   class EgtReader
   {
   private:
-    static const char kRecordContentMulti_;
-
     size_t InputPos_;
     size_t InputLen_;
     const uint8_t* Input_;
 
-    GPSTR_T FileHeader_;
     uint32_t EntryCount_;
     uint32_t EntriesRead_;
+    char Record_;
+    EgtError Error_;
 
-    GPSTR_T RawReadCString();
-    uint8_t ReadByte();
-    uint16_t RawReadUInt16();
+    bool RawReadCString(GPSTR_T *out);
+    bool RawReadUInt16(uint16_t &value);
+    bool BeginEntry(EntryType type);
 
   public:
 
@@ -84,9 +74,12 @@ namespace GoldCPP
       Property = 'p',
       CharRanges = 'c',
       Group = 'g',
-      TableCounts = 't'
+      TableCounts = 't',
+      Keyword = 'k'         // Not from GOLD, see EgtWriter
     };
 
+    EgtReader(const uint8_t* input, size_t inputLen);
+
     bool RecordComplete() const
     {
       return EntriesRead_ >= EntryCount_;
@@ -99,20 +92,87 @@ namespace GoldCPP
 
     bool EofReached() const
     {
-      assert(InputPos_ <= InputLen_);
       return InputPos_ >= InputLen_;
     }
 
-    EgtReader(const uint8_t* input, size_t inputLen);
-    Entry RetrieveEntry();
+    bool Failed() const
+    {
+      return Error_.Code != EgtErrorCode::None;
+    }
+
+    const EgtError& GetError() const
+    {
+      return Error_;
+    }
+
+    /* Records 'code' at the current offset, unless there was an error
+    already. Returns false, so it can end a chain of reads. */
+    bool Fail(EgtErrorCode code);
+
+    /* Skips what is left of the current record and starts the next one,
+    reading its type. Returns false at the end of the data or on an error. */
     bool GetNextRecord();
-    GPSTR_T RetrieveString(bool *success = NULL);
-    uint16_t RetrieveInt16(bool *success = NULL);
-    bool RetrieveBoolean(bool *success = NULL);
-    uint8_t RetrieveByte(bool *success = NULL);
+
+    /* Type of the current record, see EgtRecord. */
+    char GetRecordType() const
+    {
+      return Record_;
+    }
+
+    bool RetrieveString(GPSTR_T &value);
+    bool RetrieveInt16(uint16_t &value);
+    bool RetrieveBoolean(bool &value);
+    bool RetrieveByte(uint8_t &value);
+
+    /* Reads an index into a table of 'count' items, failing with BadIndex
+    if it is out of range. */
+    bool RetrieveIndex(uint16_t &value, size_t count);
+
+    /* Skips an entry of any type, such as a reserved one. */
+    bool SkipEntry();
+  };
+
+  /* Writes records in the format EgtReader reads, such as to save tables as
+  they are after preparing them (see GrammarTables::Save()). The data starts
+  with the header of EGT version 5.0. */
+  class EgtWriter
+  {
+  private:
+    std::vector<uint8_t> &Out_;
+    size_t CountPos_;         // Of the entry count of the current record
+    uint32_t EntryCount_;
+    bool Overflow_;
+
+    void RawWriteCString(const GPSTR_T &value);
+    void RawWriteUInt16(uint16_t value);
+
+#ifndef __GNUC__
+    EgtWriter(const EgtWriter& that){}
+#else
+    EgtWriter(const EgtWriter& that) = delete;
+#endif
+
+  public:
+    /* Appends to 'out'. */
+    explicit EgtWriter(std::vector<uint8_t> &out);
+
+    /* Starts a record of 'type', see EgtReader::EgtRecord. */
+    void BeginRecord(char type);
+    void EndRecord();
+
+    void AddString(const GPSTR_T &value);
+    void AddInt16(uint16_t value);
+    void AddBoolean(bool value);
+    void AddByte(uint8_t value);
+    void AddEmpty();
+
+    /* True if a record had more entries than the format allows. */
+    bool Overflowed() const
+    {
+      return Overflow_;
+    }
   };
 
 }
 
 #endif // GOLDCPP_EGT_H
-
@@ -37,7 +37,7 @@ namespace GoldCPP
       ErrorSymbol(NULL)
     {}
 
-    virtual void Clear()
+    void Clear()
     {
       InitialState = 0;
       ErrorSymbol = NULL;
@@ -0,0 +1,125 @@
+#ifndef GOLDCPP_GAPBUFFER_H
+#define GOLDCPP_GAPBUFFER_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cassert>
+
+namespace GoldCPP
+{
+  /* A sequence of items with a gap of unused room at some index, where
+  items are inserted and removed without moving the items behind it. Moving
+  the gap moves the items it passes, so a run of edits close to each other
+  only moves the items between them. */
+  template <typename T>
+  class GapBuffer
+  {
+  private:
+    std::vector<T> Items_;
+    size_t GapBegin_;
+    size_t GapEnd_;       // Items_[GapBegin_, GapEnd_) are unused
+
+    size_t GapLength() const
+    {
+      return GapEnd_ - GapBegin_;
+    }
+
+    void Grow(size_t count)
+    {
+      size_t size = Items_.size() - GapLength() + count;
+      size_t capacity = (2 * Items_.size() > size) ? 2 * Items_.size() : size;
+
+      std::vector<T> grown(capacity);
+      for (size_t i = 0; i < GapBegin_; ++i)
+        grown[i] = std::move(Items_[i]);
+
+      size_t tail = Items_.size() - GapEnd_;
+      for (size_t i = 0; i < tail; ++i)
+        grown[capacity - tail + i] = std::move(Items_[GapEnd_ + i]);
+
+      Items_.swap(grown);
+      GapEnd_ = capacity - tail;
+    }
+
+  public:
+
+    GapBuffer() :
+      GapBegin_(0),
+      GapEnd_(0)
+    {}
+
+    size_t Count() const
+    {
+      return Items_.size() - GapLength();
+    }
+
+    /* Index of the first item behind the gap. */
+    size_t GetGap() const
+    {
+      return GapBegin_;
+    }
+
+    void Clear()
+    {
+      Items_.clear();
+      GapBegin_ = 0;
+      GapEnd_ = 0;
+    }
+
+    /* Moves the gap in front of the item at 'index', or to the end. */
+    void MoveGap(size_t index)
+    {
+      assert(index <= Count());
+      if (GapLength() == 0)     // Nothing to move, and items must not be moved onto themselves
+      {
+        GapBegin_ = index;
+        GapEnd_ = index;
+        return;
+      }
+
+      while (GapBegin_ > index)
+        Items_[--GapEnd_] = std::move(Items_[--GapBegin_]);
+      while (GapBegin_ < index)
+        Items_[GapBegin_++] = std::move(Items_[GapEnd_++]);
+    }
+
+    /* Inserts 'item' at the gap, in front of the items behind it. */
+    void Insert(const T &item)
+    {
+      if (GapLength() == 0)
+        Grow(1);
+      Items_[GapBegin_++] = item;
+    }
+
+    /* Removes 'count' items behind the gap. */
+    void Erase(size_t count)
+    {
+      assert(count <= Items_.size() - GapEnd_);
+      for (size_t i = 0; i < count; ++i)
+        Items_[GapEnd_ + i] = T();
+      GapEnd_ += count;
+    }
+
+    /* Adds 'item' at the end, moving the gap there. */
+    void Add(const T &item)
+    {
+      MoveGap(Count());
+      Insert(item);
+    }
+
+    T& operator[] (size_t index)
+    {
+      assert(index < Count());
+      return Items_[(index < GapBegin_) ? index : index + GapLength()];
+    }
+
+    const T& operator[] (size_t index) const
+    {
+      assert(index < Count());
+      return Items_[(index < GapBegin_) ? index : index + GapLength()];
+    }
+  };
+}
+
+#endif // GOLDCPP_GAPBUFFER_H
@@ -0,0 +1,240 @@
+#include "GrammarRegistry.h"
+
+namespace GoldCPP
+{
+  GrammarRegistry::GrammarRegistry() :
+    Mutex_(), Entries_(), Stats_()
+  {
+  }
+
+  GrammarRegistry& GrammarRegistry::Global()
+  {
+    // Thread-safe since C++11
+    static GrammarRegistry registry;
+    return registry;
+  }
+
+  namespace
+  {
+    inline uint64_t Rotl(uint64_t x, int r)
+    {
+      return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t Mix(uint64_t k)
+    {
+      k ^= k >> 33;
+      k *= 0xff51afd7ed558ccdull;
+      k ^= k >> 33;
+      k *= 0xc4ceb9fe1a85ec53ull;
+      k ^= k >> 33;
+      return k;
+    }
+
+    inline uint64_t Read64(const uint8_t* p)
+    {
+      // Little-endian, whatever the machine
+      uint64_t v = 0;
+      for (int i = 7; i >= 0; --i)
+        v = (v << 8) | p[i];
+      return v;
+    }
+  }
+
+  GrammarRegistry::Digest GrammarRegistry::MakeDigest(const uint8_t* egt, size_t len)
+  {
+    // MurmurHash3_x64_128, seed 0
+    const uint64_t c1 = 0x87c37b91114253d5ull;
+    const uint64_t c2 = 0x4cf5ad432745937full;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    size_t blocks = len / 16;
+    for (size_t i = 0; i < blocks; ++i)
+    {
+      uint64_t k1 = Read64(egt + i * 16);
+      uint64_t k2 = Read64(egt + i * 16 + 8);
+
+      k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+      h1 = Rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+      k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+      h2 = Rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = egt + blocks * 16;
+    size_t rest = len & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (size_t i = rest; i > 8; --i)
+      k2 = (k2 << 8) | tail[i - 1];
+    for (size_t i = (rest < 8) ? rest : 8; i > 0; --i)
+      k1 = (k1 << 8) | tail[i - 1];
+    if (rest > 8)
+    {
+      k2 *= c2; k2 = Rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if (rest > 0)
+    {
+      k1 *= c1; k1 = Rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= (uint64_t)len;
+    h2 ^= (uint64_t)len;
+    h1 += h2;
+    h2 += h1;
+    h1 = Mix(h1);
+    h2 = Mix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    Digest digest;
+    digest.Length = len;
+    digest.Hash[0] = h1;
+    digest.Hash[1] = h2;
+    return digest;
+  }
+
+  GrammarRegistry::Loaded GrammarRegistry::Load(const uint8_t* egt, size_t len, unsigned prepare)
+  {
+    Loaded result;
+    std::shared_ptr<GrammarTables> tables = std::make_shared<GrammarTables>();
+    if (!tables->Load(egt, len))
+    {
+      result.Error = tables->GetLoadError();
+      return result;
+    }
+
+    // Hashing keywords optimizes the DFA already if it takes any out
+    size_t keywords = (prepare & HashKeywords) ? tables->HashKeywords() : 0;
+    if ((prepare & OptimizeDFA) && (keywords == 0))
+      tables->OptimizeDFA();
+    if (prepare & EliminateUnits)
+      tables->EliminateUnitProductions();
+
+    result.Tables = tables;
+    return result;
+  }
+
+  void GrammarRegistry::Sweep()
+  {
+    for (std::unordered_multimap<uint64_t, Entry>::iterator it = Entries_.begin(); it != Entries_.end(); )
+    {
+      if (!it->second.Loading.valid() && it->second.Tables.expired())
+      {
+        it = Entries_.erase(it);
+        ++Stats_.Evictions;
+      }
+      else
+        ++it;
+    }
+  }
+
+  std::shared_ptr<const GrammarTables> GrammarRegistry::Acquire(const uint8_t* egt, size_t len, unsigned prepare, EgtError *error)
+  {
+    typedef std::unordered_multimap<uint64_t, Entry>::iterator Iterator;
+
+    Digest digest = MakeDigest(egt, len);
+    std::promise<Loaded> promise;
+    std::shared_future<Loaded> loading;
+    bool loader = false;
+    {
+      std::lock_guard<std::mutex> lock(Mutex_);
+
+      std::pair<Iterator, Iterator> candidates = Entries_.equal_range(digest.Hash[0]);
+      for (Iterator it = candidates.first; it != candidates.second; ++it)
+      {
+        Entry &entry = it->second;
+        if ((entry.Prepared != prepare) || !(entry.Egt == digest))
+          continue;
+
+        ++Stats_.Hits;
+        if (entry.Loading.valid())
+        {
+          // Being loaded by another thread, wait for it below
+          loading = entry.Loading;
+          break;
+        }
+
+        std::shared_ptr<const GrammarTables> tables = entry.Tables.lock();
+        if (tables)
+        {
+          if (error)
+            *error = EgtError();
+          return tables;
+        }
+
+        // Freed since, load it again below
+        --Stats_.Hits;
+        Entries_.erase(it);
+        ++Stats_.Evictions;
+        break;
+      }
+
+      if (!loading.valid())
+      {
+        ++Stats_.Misses;
+        Sweep();
+
+        Entry entry;
+        entry.Egt = digest;
+        entry.Prepared = prepare;
+        entry.Loading = promise.get_future().share();
+        Entries_.insert(std::make_pair(digest.Hash[0], entry));
+
+        loading = entry.Loading;
+        loader = true;
+      }
+    }
+
+    if (loader)
+    {
+      promise.set_value(Load(egt, len, prepare));
+
+      std::lock_guard<std::mutex> lock(Mutex_);
+      std::pair<Iterator, Iterator> candidates = Entries_.equal_range(digest.Hash[0]);
+      for (Iterator it = candidates.first; it != candidates.second; ++it)
+      {
+        // Only one entry of a grammar is ever being loaded
+        Entry &entry = it->second;
+        if ((entry.Prepared != prepare) || !(entry.Egt == digest) || !entry.Loading.valid())
+          continue;
+
+        entry.Tables = loading.get().Tables;
+        entry.Loading = std::shared_future<Loaded>();
+        if (entry.Tables.expired())
+        {
+          Entries_.erase(it);
+          ++Stats_.Failures;
+        }
+        break;
+      }
+    }
+
+    const Loaded &result = loading.get();
+    if (error)
+      *error = result.Error;
+    return result.Tables;
+  }
+
+  size_t GrammarRegistry::Purge()
+  {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    size_t before = Entries_.size();
+    Sweep();
+    return before - Entries_.size();
+  }
+
+  GrammarRegistryStats GrammarRegistry::GetStats() const
+  {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    GrammarRegistryStats stats = Stats_;
+    stats.Grammars = 0;
+    for (std::unordered_multimap<uint64_t, Entry>::const_iterator it = Entries_.begin(); it != Entries_.end(); ++it)
+    {
+      if (!it->second.Tables.expired())
+        ++stats.Grammars;
+    }
+    return stats;
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef GOLDCPP_GRAMMARREGISTRY_H
+#define GOLDCPP_GRAMMARREGISTRY_H
+
+#include "GrammarTables.h"
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  struct GrammarRegistryStats
+  {
+    uint64_t Hits;          // Tables handed out that were loaded already
+    uint64_t Misses;        // Tables loaded, including failed loads
+    uint64_t Failures;      // Loads that failed, see Acquire()
+    uint64_t Evictions;     // Tables freed by their last user, and forgotten since
+    size_t Grammars;        // Tables in use now
+
+    GrammarRegistryStats() :
+      Hits(0), Misses(0), Failures(0), Evictions(0), Grammars(0)
+    {}
+  };
+
+  /* Loads each distinct grammar once and hands out its tables to everyone
+  who asks for the same EGT data, so all Parsers of a grammar share one copy
+  (see Parser::UseTables() and SimpleParser). Grammars are told apart by
+  their content, not by where it is: by its length and a 128-bit hash of it,
+  so the data itself is not kept. Tables are only held weakly, so they are
+  freed when their last user lets go, and loaded again if needed later.
+  All methods may be called from any thread. */
+  class GrammarRegistry
+  {
+  public:
+
+    /* Done to tables after loading, before they are shared. Tables prepared
+    differently are kept apart. */
+    enum Preparation : unsigned
+    {
+      None = 0,
+      OptimizeDFA = 1,        // See Parser::OptimizeDFA()
+      HashKeywords = 2,       // See Parser::HashKeywords()
+      EliminateUnits = 4      // See Parser::EliminateUnitProductions()
+    };
+
+  private:
+    struct Digest
+    {
+      uint64_t Length;
+      uint64_t Hash[2];       // MurmurHash3, x64 128-bit variant
+
+      bool operator==(const Digest &other) const
+      {
+        return (Length == other.Length) && (Hash[0] == other.Hash[0]) && (Hash[1] == other.Hash[1]);
+      }
+    };
+
+    struct Loaded
+    {
+      std::shared_ptr<const GrammarTables> Tables;    // NULL if the load failed
+      EgtError Error;
+    };
+
+    struct Entry
+    {
+      Digest Egt;
+      unsigned Prepared;
+      std::shared_future<Loaded> Loading;             // Valid while the first thread asking loads the tables
+      std::weak_ptr<const GrammarTables> Tables;      // Once loaded
+    };
+
+    mutable std::mutex Mutex_;
+    std::unordered_multimap<uint64_t, Entry> Entries_;   // By Digest::Hash[0]
+    GrammarRegistryStats Stats_;
+
+    static Digest MakeDigest(const uint8_t* egt, size_t len);
+    static Loaded Load(const uint8_t* egt, size_t len, unsigned prepare);
+    void Sweep();
+
+#ifndef __GNUC__
+    GrammarRegistry(const GrammarRegistry& that){}
+#else
+    GrammarRegistry(const GrammarRegistry& that) = delete;
+#endif
+
+  public:
+
+    GrammarRegistry();
+
+    /* The registry shared by the whole process. */
+    static GrammarRegistry& Global();
+
+    /* Tables loaded from 'egt' and prepared as asked, loading them if no one
+    holds them yet. Loads are done outside the registry's lock: threads asking
+    for a grammar being loaded wait for that load, everyone else goes on.
+    Returns NULL if the data cannot be loaded, with the reason in 'error' if
+    it is given. Failures are not remembered. */
+    std::shared_ptr<const GrammarTables> Acquire(const uint8_t* egt, size_t len, unsigned prepare = None, EgtError *error = NULL);
+
+    /* Forgets grammars no one uses anymore. Acquire() does this from time
+    to time anyway. Returns the number forgotten. */
+    size_t Purge();
+
+    GrammarRegistryStats GetStats() const;
+  };
+}
+
+#endif // GOLDCPP_GRAMMARREGISTRY_H
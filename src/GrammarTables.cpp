@@ -0,0 +1,821 @@
+#include "GrammarTables.h"
+#include <algorithm>
+
+namespace GoldCPP
+{
+  void GrammarProperties::setProperty(PropertyIndex index, const GPSTR_T &val)
+  {
+    _Properties[index] = val;
+  }
+
+  GPSTR_T GrammarProperties::getProperty(PropertyIndex index) const
+  {
+    return _Properties[index];
+  }
+
+  size_t GrammarProperties::HeapBytes() const
+  {
+    size_t bytes = 0;
+    for (size_t i = 0; i < GOLD_CPP_GRAMMAR_PROPERTY_COUNT; ++i)
+      bytes += GoldCPP::HeapBytes(_Properties[i]);
+    return bytes;
+  }
+
+  GrammarTables::GrammarTables() :
+    Loaded_(false)
+  {
+  }
+
+  void GrammarTables::Clear()
+  {
+    SymbolTable_.Clear();
+    DFA_.Clear();
+    CharSetTable_.Clear();
+    Keywords_.Clear();
+    ProductionTable_.Clear();
+    HandleIds_.clear();
+    DisplayText_.Clear();
+    LRStates_.Clear();
+    GroupTable_.Clear();
+    NoiseRuns_.Clear();
+    GroupScans_.Clear();
+    Grammar_ = GrammarProperties();
+    Loaded_ = false;
+    LoadError_ = EgtError();
+  }
+
+  bool GrammarTables::Load(const uint8_t* binstream, size_t len)
+  {
+    Clear();
+
+    EgtReader EGT(binstream, len);
+
+    std::vector<size_t> handleStarts;     // Of each production in HandleIds_
+    bool countsRead = false;
+    bool initialStatesRead = false;
+
+    std::vector<KeywordTable::Entry> keywords;    // Taken out of the DFA before saving
+
+    // Which items of each table were defined
+    std::vector<bool> symbolsRead, charSetsRead, productionsRead, dfaRead, lrRead, groupsRead;
+
+    while (EGT.GetNextRecord())
+    {
+      switch (EGT.GetRecordType())
+      {
+      case EgtReader::Property:
+        {
+        uint16_t index;
+        GPSTR_T name, value;
+        if (!EGT.RetrieveInt16(index) || !EGT.RetrieveString(name) || !EGT.RetrieveString(value))
+          break;
+        // Properties added by later versions are of no use here
+        if (index < GOLD_CPP_GRAMMAR_PROPERTY_COUNT)
+          Grammar_.setProperty((GrammarProperties::PropertyIndex)index, value);
+        break;
+        }
+      case EgtReader::TableCounts:
+        {
+        // Items already read point into the tables
+        if (countsRead)
+        {
+          EGT.Fail(EgtErrorCode::BadRecord);
+          break;
+        }
+        countsRead = true;
+
+        uint16_t symbols, charSets, productions, dfaStates, lrStates, groups;
+        if (!EGT.RetrieveInt16(symbols) || !EGT.RetrieveInt16(charSets) || !EGT.RetrieveInt16(productions)
+          || !EGT.RetrieveInt16(dfaStates) || !EGT.RetrieveInt16(lrStates) || !EGT.RetrieveInt16(groups))
+          break;
+
+        SymbolTable_ = SymbolList(symbols);
+        CharSetTable_ = CharacterSetList(charSets);
+        ProductionTable_ = ProductionList(productions);
+        handleStarts.resize(productions, 0);
+        DFA_ = FaStateList(dfaStates);
+        LRStates_ = LRStateList(lrStates);
+        GroupTable_ = GroupList(groups);
+
+        symbolsRead.resize(symbols, false);
+        charSetsRead.resize(charSets, false);
+        productionsRead.resize(productions, false);
+        dfaRead.resize(dfaStates, false);
+        lrRead.resize(lrStates, false);
+        groupsRead.resize(groups, false);
+        break;
+        }
+      case EgtReader::InitialStates:
+        {
+        if (!EGT.RetrieveIndex(DFA_.InitialState, DFA_.Count())
+          || !EGT.RetrieveIndex(LRStates_.InitialState, LRStates_.Count()))
+          break;
+        initialStatesRead = true;
+        break;
+        }
+      case EgtReader::Symbol:
+        {
+        uint16_t index, type;
+        if (!EGT.RetrieveIndex(index, SymbolTable_.Count()))
+          break;
+
+        Symbol &sym = SymbolTable_[index];
+        if (!EGT.RetrieveString(sym.Name) || !EGT.RetrieveInt16(type))
+          break;
+        if (type > Symbol::Error)
+        {
+          EGT.Fail(EgtErrorCode::BadIndex);
+          break;
+        }
+
+        sym.Type = (Symbol::SymbolType)type;
+        sym.TableIndex = index;
+        symbolsRead[index] = true;
+        break;
+        }
+      case EgtReader::Group:
+        {
+        uint16_t index;
+        if (!EGT.RetrieveIndex(index, GroupTable_.Count()))
+          break;
+
+        GroupTable_[index] = Group();
+        Group *G = &(GroupTable_[index]);
+        G->TableIndex = index;
+
+        uint16_t container, start, end, advance, ending, count;
+        size_t symbols = SymbolTable_.Count();
+        if (!EGT.RetrieveString(G->Name) || !EGT.RetrieveIndex(container, symbols)
+          || !EGT.RetrieveIndex(start, symbols) || !EGT.RetrieveIndex(end, symbols)
+          || !EGT.RetrieveIndex(advance, 2) || !EGT.RetrieveIndex(ending, 2)
+          || !EGT.SkipEntry()     // Reserved
+          || !EGT.RetrieveInt16(count))
+          break;
+
+        G->Container = &(SymbolTable_[container]);
+        G->Start = &(SymbolTable_[start]);
+        G->End = &(SymbolTable_[end]);
+        G->Advance = (Group::AdvanceMode)advance;
+        G->Ending = (Group::EndingMode)ending;
+
+        G->Nesting.Reserve(count);
+        for (uint16_t i = 0; i < count; ++i)
+        {
+          uint16_t nested;
+          if (!EGT.RetrieveIndex(nested, GroupTable_.Count()))
+            break;
+          G->Nesting.Add(nested);
+        }
+
+        // Link back
+        G->Container->GoldGroup = G;
+        G->Start->GoldGroup = G;
+        G->End->GoldGroup = G;
+
+        groupsRead[index] = true;
+        break;
+        }
+      case EgtReader::CharRanges:
+        {
+        uint16_t index, codepage, total;
+        if (!EGT.RetrieveIndex(index, CharSetTable_.Count()) || !EGT.RetrieveInt16(codepage)
+          || !EGT.RetrieveInt16(total) || !EGT.SkipEntry())   // Reserved
+          break;
+
+        CharSetTable_[index] = CharacterSet();
+        CharacterSet *charSet = &(CharSetTable_[index]);
+        charSet->Reserve(total);
+
+        while (!EGT.RecordComplete())
+        {
+          uint16_t rangeStart, rangeEnd;
+          if (!EGT.RetrieveInt16(rangeStart) || !EGT.RetrieveInt16(rangeEnd))
+            break;
+          if (rangeStart > rangeEnd)
+          {
+            EGT.Fail(EgtErrorCode::BadIndex);
+            break;
+          }
+          charSet->Add(CharacterRange(rangeStart, rangeEnd));
+        }
+
+        if (!EGT.Failed() && (charSet->Count() != total))
+          EGT.Fail(EgtErrorCode::BadIndex);
+        charSetsRead[index] = true;
+        break;
+        }
+      case EgtReader::Production:
+        {
+        uint16_t index, headIndex;
+        if (!EGT.RetrieveIndex(index, ProductionTable_.Count())
+          || !EGT.RetrieveIndex(headIndex, SymbolTable_.Count())
+          || !EGT.SkipEntry())    // Reserved
+          break;
+
+        ProductionTable_[index] = Production(&(SymbolTable_[headIndex]), index);
+
+        // Handles are placed in HandleIds_ after all records are read, as it may grow until then
+        size_t start = HandleIds_.size();
+        while (!EGT.RecordComplete())
+        {
+          uint16_t symIndex;
+          if (!EGT.RetrieveIndex(symIndex, SymbolTable_.Count()))
+            break;
+          HandleIds_.push_back(symIndex);
+        }
+        handleStarts[index] = start;
+        ProductionTable_[index].Handle = SymbolIdSpan(NULL, HandleIds_.size() - start, &SymbolTable_);
+        productionsRead[index] = true;
+        break;
+        }
+      case EgtReader::DFAState:
+        {
+        uint16_t index, acceptIndex;
+        bool accept;
+        if (!EGT.RetrieveIndex(index, DFA_.Count()) || !EGT.RetrieveBoolean(accept)
+          || !EGT.RetrieveInt16(acceptIndex) || !EGT.SkipEntry())   // Reserved
+          break;
+
+        if (accept)
+        {
+          if (acceptIndex >= SymbolTable_.Count())
+          {
+            EGT.Fail(EgtErrorCode::BadIndex);
+            break;
+          }
+          DFA_[index] = FaState(&(SymbolTable_[acceptIndex]));
+        }
+        else
+          DFA_[index] = FaState();
+
+        // Three entries per edge, after five for the record type and the state
+        FaEdgeList &edgeList = DFA_[index].Edges;
+        if (EGT.GetEntryCount() > 5)
+          edgeList.Reserve((EGT.GetEntryCount() - 5) / 3);
+
+        while (!EGT.RecordComplete())
+        {
+          uint16_t setIndex, target;
+          if (!EGT.RetrieveIndex(setIndex, CharSetTable_.Count())
+            || !EGT.RetrieveIndex(target, DFA_.Count())
+            || !EGT.SkipEntry())    // Reserved
+            break;
+          edgeList.Add(FaEdge(&(CharSetTable_[setIndex]), target));
+        }
+        dfaRead[index] = true;
+        break;
+        }
+      case EgtReader::LRState:
+        {
+        uint16_t index;
+        if (!EGT.RetrieveIndex(index, LRStates_.Count()) || !EGT.SkipEntry())   // Reserved
+          break;
+
+        LRStates_[index] = LRState();
+
+        // Four entries per action, after three for the record type and the state
+        Vector<LRAction> &actionList = LRStates_[index].Actions;
+        if (EGT.GetEntryCount() > 3)
+          actionList.Reserve((EGT.GetEntryCount() - 3) / 4);
+
+        while (!EGT.RecordComplete())
+        {
+          uint16_t symIndex, action, target;
+          if (!EGT.RetrieveIndex(symIndex, SymbolTable_.Count()) || !EGT.RetrieveInt16(action)
+            || !EGT.RetrieveInt16(target) || !EGT.SkipEntry())    // Reserved
+            break;
+
+          bool valid;
+          switch ((LRActionType)action)
+          {
+          case LRActionType::Shift:
+          case LRActionType::Goto:
+            valid = (target < LRStates_.Count());
+            break;
+          case LRActionType::Reduce:
+            valid = (target < ProductionTable_.Count());
+            break;
+          case LRActionType::Accept:
+            valid = true;
+            break;
+          default:
+            valid = false;
+            break;
+          }
+          if (!valid)
+          {
+            EGT.Fail(EgtErrorCode::BadIndex);
+            break;
+          }
+
+          actionList.Add(LRAction(&(SymbolTable_[symIndex]), (LRActionType)action, target));
+        }
+        lrRead[index] = true;
+        break;
+        }
+      case EgtReader::Keyword:
+        {
+        uint16_t keyword, identifier;
+        GPSTR_T text;
+        bool ignoreCase = false;    // Not written by earlier versions
+        if (!EGT.RetrieveIndex(keyword, SymbolTable_.Count()) || !EGT.RetrieveIndex(identifier, SymbolTable_.Count())
+          || !EGT.RetrieveString(text) || (!EGT.RecordComplete() && !EGT.RetrieveBoolean(ignoreCase)))
+          break;
+
+        keywords.push_back(KeywordTable::Entry(text, &(SymbolTable_[identifier]), &(SymbolTable_[keyword]), ignoreCase));
+        break;
+        }
+      default:
+        {
+        EGT.Fail(EgtErrorCode::UnknownRecord);
+        break;
+        }
+      } // switch
+    } // loop
+
+    LoadError_ = EGT.GetError();
+    if (LoadError_.Code == EgtErrorCode::None)
+    {
+      // Everything the parser relies on must have been defined
+      char missing = 0;
+      if (!countsRead)
+        missing = EgtReader::TableCounts;
+      else if (!initialStatesRead)
+        missing = EgtReader::InitialStates;
+      else if (std::find(symbolsRead.begin(), symbolsRead.end(), false) != symbolsRead.end())
+        missing = EgtReader::Symbol;
+      else if (std::find(charSetsRead.begin(), charSetsRead.end(), false) != charSetsRead.end())
+        missing = EgtReader::CharRanges;
+      else if (std::find(productionsRead.begin(), productionsRead.end(), false) != productionsRead.end())
+        missing = EgtReader::Production;
+      else if (std::find(dfaRead.begin(), dfaRead.end(), false) != dfaRead.end())
+        missing = EgtReader::DFAState;
+      else if (std::find(lrRead.begin(), lrRead.end(), false) != lrRead.end())
+        missing = EgtReader::LRState;
+      else if (std::find(groupsRead.begin(), groupsRead.end(), false) != groupsRead.end())
+        missing = EgtReader::Group;
+      else if (!SymbolTable_.GetFirstOfType(Symbol::End) || !SymbolTable_.GetFirstOfType(Symbol::Error))
+        missing = EgtReader::Symbol;    // The lexer makes tokens of both
+
+      // Records that are fine by themselves, but not with the others
+      char bad = 0;
+      for (size_t i = 0; !missing && (i < SymbolTable_.Count()); ++i)
+      {
+        // Tokens of these types are handled through their group
+        const Symbol &sym = SymbolTable_[i];
+        if (((sym.Type == Symbol::GroupStart) || (sym.Type == Symbol::GroupEnd)) && !sym.GoldGroup)
+          bad = EgtReader::Group;
+      }
+
+      // The parser takes nonterminals read as subtrees of a previous tree, so none may be lexed
+      for (size_t i = 0; !missing && (i < DFA_.Count()); ++i)
+      {
+        if (DFA_[i].Accept && (DFA_[i].Accept->Type == Symbol::Nonterminal))
+          bad = EgtReader::DFAState;
+      }
+      for (size_t i = 0; !missing && (i < GroupTable_.Count()); ++i)
+      {
+        if (GroupTable_[i].Container->Type == Symbol::Nonterminal)
+          bad = EgtReader::Group;
+      }
+      for (size_t i = 0; i < keywords.size(); ++i)
+      {
+        if (keywords[i].Keyword->Type == Symbol::Nonterminal)
+          bad = EgtReader::Keyword;
+      }
+
+      if (missing)
+      {
+        LoadError_.Code = EgtErrorCode::MissingItem;
+        LoadError_.Offset = len;
+        LoadError_.Record = missing;
+      }
+      else if (bad)
+      {
+        LoadError_.Code = EgtErrorCode::BadRecord;
+        LoadError_.Offset = len;
+        LoadError_.Record = bad;
+      }
+      else if (!Keywords_.Restore(keywords))
+      {
+        LoadError_.Code = EgtErrorCode::BadRecord;
+        LoadError_.Offset = len;
+        LoadError_.Record = EgtReader::Keyword;
+      }
+    }
+
+    bool Success = (LoadError_.Code == EgtErrorCode::None);
+    if (Success)
+    {
+      for (size_t i = 0; i < ProductionTable_.Count(); ++i)
+      {
+        Production &prod = ProductionTable_[i];
+        prod.Handle = SymbolIdSpan(HandleIds_.data() + handleStarts[i], prod.Handle.Count(), &SymbolTable_);
+      }
+
+      for (size_t i = 0; i < SymbolTable_.Count(); ++i)
+        SymbolTable_[i].RenderText(DisplayText_);
+      for (size_t i = 0; i < ProductionTable_.Count(); ++i)
+        ProductionTable_[i].RenderText(DisplayText_);
+
+      FindNoiseRuns();
+      FindGroupScans();
+
+      for (size_t i = 0; i < LRStates_.Count(); ++i)
+        LRStates_[i].FindExpected();
+    }
+    else
+    {
+      // Keep no half-loaded tables, and the error
+      EgtError error = LoadError_;
+      Clear();
+      LoadError_ = error;
+    }
+
+    Loaded_ = Success;
+    return Success;
+
+  } // method
+
+  static const GPCHR_T* const kPropertyNames[GOLD_CPP_GRAMMAR_PROPERTY_COUNT] =
+  {
+    GPSTR_C("Name"), GPSTR_C("Version"), GPSTR_C("Author"), GPSTR_C("About"),
+    GPSTR_C("Character Set"), GPSTR_C("Character Mapping"), GPSTR_C("Generated By"), GPSTR_C("Generated Date")
+  };
+
+  bool GrammarTables::Save(std::vector<uint8_t> &out) const
+  {
+    out.clear();
+    if (!Loaded_)
+      return false;
+
+    EgtWriter EGT(out);
+
+    for (uint16_t i = 0; i < GOLD_CPP_GRAMMAR_PROPERTY_COUNT; ++i)
+    {
+      EGT.BeginRecord(EgtReader::Property);
+      EGT.AddInt16(i);
+      EGT.AddString(kPropertyNames[i]);
+      EGT.AddString(Grammar_.getProperty((GrammarProperties::PropertyIndex)i));
+      EGT.EndRecord();
+    }
+
+    EGT.BeginRecord(EgtReader::TableCounts);
+    EGT.AddInt16((uint16_t)SymbolTable_.Count());
+    EGT.AddInt16((uint16_t)CharSetTable_.Count());
+    EGT.AddInt16((uint16_t)ProductionTable_.Count());
+    EGT.AddInt16((uint16_t)DFA_.Count());
+    EGT.AddInt16((uint16_t)LRStates_.Count());
+    EGT.AddInt16((uint16_t)GroupTable_.Count());
+    EGT.EndRecord();
+
+    EGT.BeginRecord(EgtReader::InitialStates);
+    EGT.AddInt16(DFA_.InitialState);
+    EGT.AddInt16(LRStates_.InitialState);
+    EGT.EndRecord();
+
+    for (size_t i = 0; i < CharSetTable_.Count(); ++i)
+    {
+      const CharacterSet &charSet = CharSetTable_[i];
+      EGT.BeginRecord(EgtReader::CharRanges);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddInt16(0);    // Codepage
+      EGT.AddInt16((uint16_t)charSet.Count());
+      EGT.AddEmpty();
+      for (size_t r = 0; r < charSet.Count(); ++r)
+      {
+        EGT.AddInt16((uint16_t)charSet[r].Start);
+        EGT.AddInt16((uint16_t)charSet[r].End);
+      }
+      EGT.EndRecord();
+    }
+
+    for (size_t i = 0; i < SymbolTable_.Count(); ++i)
+    {
+      const Symbol &sym = SymbolTable_[i];
+      EGT.BeginRecord(EgtReader::Symbol);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddString(sym.Name);
+      EGT.AddInt16((uint16_t)sym.Type);
+      EGT.EndRecord();
+    }
+
+    for (size_t i = 0; i < GroupTable_.Count(); ++i)
+    {
+      const Group &G = GroupTable_[i];
+      EGT.BeginRecord(EgtReader::Group);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddString(G.Name);
+      EGT.AddInt16((uint16_t)G.Container->TableIndex);
+      EGT.AddInt16((uint16_t)G.Start->TableIndex);
+      EGT.AddInt16((uint16_t)G.End->TableIndex);
+      EGT.AddInt16((uint16_t)G.Advance);
+      EGT.AddInt16((uint16_t)G.Ending);
+      EGT.AddEmpty();
+      EGT.AddInt16((uint16_t)G.Nesting.Count());
+      for (size_t n = 0; n < G.Nesting.Count(); ++n)
+        EGT.AddInt16(G.Nesting[n]);
+      EGT.EndRecord();
+    }
+
+    for (size_t i = 0; i < ProductionTable_.Count(); ++i)
+    {
+      const Production &prod = ProductionTable_[i];
+      EGT.BeginRecord(EgtReader::Production);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddInt16((uint16_t)prod.Head->TableIndex);
+      EGT.AddEmpty();
+      for (size_t n = 0; n < prod.Handle.Count(); ++n)
+        EGT.AddInt16(prod.Handle.GetId(n));
+      EGT.EndRecord();
+    }
+
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      const FaState &state = DFA_[i];
+      EGT.BeginRecord(EgtReader::DFAState);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddBoolean(state.Accept != NULL);
+      EGT.AddInt16(state.Accept ? (uint16_t)state.Accept->TableIndex : 0);
+      EGT.AddEmpty();
+      for (size_t n = 0; n < state.Edges.Count(); ++n)
+      {
+        const FaEdge &edge = state.Edges[n];
+        EGT.AddInt16((uint16_t)(edge.Characters - &CharSetTable_[0]));
+        EGT.AddInt16(edge.Target);
+        EGT.AddEmpty();
+      }
+      EGT.EndRecord();
+    }
+
+    for (size_t i = 0; i < LRStates_.Count(); ++i)
+    {
+      const Vector<LRAction> &actions = LRStates_[i].Actions;
+      EGT.BeginRecord(EgtReader::LRState);
+      EGT.AddInt16((uint16_t)i);
+      EGT.AddEmpty();
+      for (size_t n = 0; n < actions.Count(); ++n)
+      {
+        EGT.AddInt16((uint16_t)actions[n].Sym->TableIndex);
+        EGT.AddInt16((uint16_t)actions[n].Type);
+        EGT.AddInt16(actions[n].Value);
+        EGT.AddEmpty();
+      }
+      EGT.EndRecord();
+    }
+
+    std::vector<KeywordTable::Entry> keywords;
+    Keywords_.GetEntries(keywords);
+    for (size_t i = 0; i < keywords.size(); ++i)
+    {
+      EGT.BeginRecord(EgtReader::Keyword);
+      EGT.AddInt16((uint16_t)keywords[i].Keyword->TableIndex);
+      EGT.AddInt16((uint16_t)keywords[i].Identifier->TableIndex);
+      EGT.AddString(keywords[i].Text);
+      EGT.AddBoolean(keywords[i].IgnoreCase);
+      EGT.EndRecord();
+    }
+
+    if (EGT.Overflowed())
+    {
+      out.clear();
+      return false;
+    }
+    return true;
+  }
+
+  void GrammarTables::OptimizeDFA()
+  {
+    if (!Loaded_)
+      return;
+
+    DfaOptimizer optimizer(DFA_, CharSetTable_);
+    optimizer.Minimize();
+    optimizer.MergeCharacterSets();
+    optimizer.Reorder();
+
+    // These point into the tables replaced
+    FindNoiseRuns();
+    FindGroupScans();
+  }
+
+  DfaStats GrammarTables::GetDfaStats() const
+  {
+    return DfaOptimizer::Measure(DFA_, CharSetTable_);
+  }
+
+  TableMemory GrammarTables::GetMemory() const
+  {
+    TableMemory result;
+
+    result.Symbols = sizeof(SymbolTable_) + HeapBytes(SymbolTable_) + sizeof(DisplayText_) + DisplayText_.HeapBytes();
+    for (size_t i = 0; i < SymbolTable_.Count(); ++i)
+      result.Symbols += HeapBytes(SymbolTable_[i].Name);
+
+    result.Dfa = sizeof(DFA_) + HeapBytes(DFA_);
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+      result.Dfa += HeapBytes(DFA_[i].Edges);
+
+    result.CharacterSets = sizeof(CharSetTable_) + HeapBytes(CharSetTable_);
+    for (size_t i = 0; i < CharSetTable_.Count(); ++i)
+      result.CharacterSets += HeapBytes(CharSetTable_[i]);
+
+    result.Productions = sizeof(ProductionTable_) + HeapBytes(ProductionTable_) + sizeof(HandleIds_) + HeapBytes(HandleIds_);
+
+    result.LRStates = sizeof(LRStates_) + HeapBytes(LRStates_);
+    for (size_t i = 0; i < LRStates_.Count(); ++i)
+      result.LRStates += HeapBytes(LRStates_[i].Actions) + LRStates_[i].Expected.HeapBytes();
+
+    result.Groups = sizeof(GroupTable_) + HeapBytes(GroupTable_);
+    for (size_t i = 0; i < GroupTable_.Count(); ++i)
+      result.Groups += HeapBytes(GroupTable_[i].Name) + HeapBytes(GroupTable_[i].Nesting);
+
+    result.Other = sizeof(Grammar_) + Grammar_.HeapBytes() + sizeof(Keywords_) + Keywords_.HeapBytes() +
+      sizeof(NoiseRuns_) + HeapBytes(NoiseRuns_) + sizeof(GroupScans_) + HeapBytes(GroupScans_);
+
+    return result;
+  }
+
+  size_t GrammarTables::HashKeywords()
+  {
+    if (Loaded_ && (Keywords_.Count() == 0) && (Keywords_.Extract(DFA_) > 0))
+      OptimizeDFA();
+
+    return Keywords_.Count();
+  }
+
+  bool GrammarTables::ApplyProfile(const TableProfile &profile)
+  {
+    if (!Loaded_ || (profile.Fingerprint != TableProfile::GetFingerprint(DFA_, LRStates_)))
+      return false;
+
+    // The counts must fit the tables, even if a profile file was changed
+    if ((profile.DfaStates.size() != DFA_.Count()) || (profile.DfaEdges.size() != DFA_.Count()) ||
+        (profile.LRStates.size() != LRStates_.Count()) || (profile.LRActions.size() != LRStates_.Count()))
+      return false;
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      if (profile.DfaEdges[i].size() != DFA_[i].Edges.Count())
+        return false;
+    }
+    for (size_t i = 0; i < LRStates_.Count(); ++i)
+    {
+      if (profile.LRActions[i].size() != LRStates_[i].Actions.Count())
+        return false;
+    }
+
+    // Items first, as they are counted by the old state numbers
+    DfaOptimizer optimizer(DFA_, CharSetTable_);
+    optimizer.SortEdges(profile.DfaEdges);
+    optimizer.Reorder(profile.DfaStates);
+
+    for (size_t i = 0; i < LRStates_.Count(); ++i)
+      LRStates_[i].SortActions(profile.LRActions[i]);
+    LRStates_.Reorder(profile.LRStates);
+
+    FindNoiseRuns();
+    FindGroupScans();
+
+    return true;
+  }
+
+  size_t GrammarTables::EliminateUnitProductions()
+  {
+    if (!Loaded_)
+      return 0;
+
+    return LRStates_.EliminateUnitProductions(ProductionTable_);
+  }
+
+  void GrammarTables::FindNoiseRuns()
+  {
+    /* Looks for edges of the initial DFA state that lead to a state which
+    accepts a Noise symbol and whose only edge is a loop back to itself.
+    Starting with such an edge, the DFA always matches exactly the longest
+    run of loop characters, so we can skip the run without running the DFA.
+    Unminimized tables may have one extra state before the loop
+    (as in "x x*"), which is accepted too if it is equivalent. */
+
+    NoiseRuns_.Clear();
+    if (DFA_.Count() == 0)
+      return;
+
+    const FaEdgeList &initialEdges = DFA_[DFA_.InitialState].Edges;
+    for (size_t i = 0; i < initialEdges.Count(); ++i)
+    {
+      uint16_t target = initialEdges[i].Target;
+      if (target == DFA_.InitialState)
+        continue;
+
+      const FaState &state = DFA_[target];
+      if ((state.Accept == NULL) || (state.Accept->Type != Symbol::SymbolType::Noise))
+        continue;
+      if (state.Edges.Count() != 1)
+        continue;
+
+      const FaEdge &edge = state.Edges[0];
+      if (edge.Target != target)
+      {
+        const FaState &loop = DFA_[edge.Target];
+        if ((loop.Accept != state.Accept) || (loop.Edges.Count() != 1) || (loop.Edges[0].Target != edge.Target))
+          continue;
+        if (!(*(loop.Edges[0].Characters) == *(edge.Characters)))
+          continue;
+      }
+
+      NoiseRun run;
+      run.First = initialEdges[i].Characters;
+      if (run.Rest.Assign(*(edge.Characters)))
+        NoiseRuns_.Add(run);
+    }
+  }
+
+  static bool RangeStartsBefore(const CharacterRange &a, const CharacterRange &b)
+  {
+    return a.Start < b.Start;
+  }
+
+  void GrammarTables::FindGroupScans()
+  {
+    /* Inside a group that advances by character, a DFA match only matters
+    where the group's End symbol or the Start symbol of a nestable group
+    begins. Everywhere else exactly one character is appended to the group.
+    So we collect the characters these symbols can begin with, and let
+    ScanGroupBody() copy everything in between without running the DFA. */
+
+    GroupScans_ = Vector<GroupScan>(GroupTable_.Count());
+    if (DFA_.Count() == 0)
+      return;
+
+    // Reverse DFA edges, to find the states leading to a given symbol
+    std::vector<std::vector<uint16_t>> Sources(DFA_.Count());
+    for (size_t i = 0; i < DFA_.Count(); ++i)
+    {
+      for (size_t n = 0; n < DFA_[i].Edges.Count(); ++n)
+        Sources[DFA_[i].Edges[n].Target].push_back((uint16_t)i);
+    }
+
+    for (size_t g = 0; g < GroupTable_.Count(); ++g)
+    {
+      const Group &G = GroupTable_[g];
+      if (G.Advance != Group::AdvanceMode::Character)
+        continue;
+
+      std::vector<bool> Leads(DFA_.Count(), false);
+      std::vector<uint16_t> Pending;
+      for (size_t i = 0; i < DFA_.Count(); ++i)
+      {
+        const Symbol *accept = DFA_[i].Accept;
+        if (accept == NULL)
+          continue;
+
+        if ((accept == G.End) ||
+            ((accept->Type == Symbol::SymbolType::GroupStart) && G.Nesting.Contains(accept->GoldGroup->TableIndex)))
+        {
+          Leads[i] = true;
+          Pending.push_back((uint16_t)i);
+        }
+      }
+
+      while (!Pending.empty())
+      {
+        uint16_t state = Pending.back();
+        Pending.pop_back();
+        for (size_t n = 0; n < Sources[state].size(); ++n)
+        {
+          uint16_t source = Sources[state][n];
+          if (!Leads[source])
+          {
+            Leads[source] = true;
+            Pending.push_back(source);
+          }
+        }
+      }
+
+      // The DFA treats NUL as the end of the input, so we must stop there too
+      std::vector<CharacterRange> Ranges(1, CharacterRange(0, 0));
+      const FaEdgeList &initialEdges = DFA_[DFA_.InitialState].Edges;
+      for (size_t n = 0; n < initialEdges.Count(); ++n)
+      {
+        if (!Leads[initialEdges[n].Target])
+          continue;
+
+        const CharacterSet &chars = *(initialEdges[n].Characters);
+        for (size_t r = 0; r < chars.Count(); ++r)
+          Ranges.push_back(chars[r]);
+      }
+
+      std::sort(Ranges.begin(), Ranges.end(), RangeStartsBefore);
+      CharacterSet Stops;
+      for (size_t r = 0; r < Ranges.size(); ++r)
+      {
+        if ((Stops.Count() > 0) && (Ranges[r].Start <= Stops[Stops.Count()-1].End + 1))
+          Stops[Stops.Count()-1].End = std::max(Stops[Stops.Count()-1].End, Ranges[r].End);
+        else
+          Stops.Add(Ranges[r]);
+      }
+
+      GroupScans_[g].Enabled = GroupScans_[g].Stops.Assign(Stops);
+    }
+  }
+}
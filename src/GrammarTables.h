@@ -0,0 +1,192 @@
+#ifndef GOLDCPP_GRAMMARTABLES_H
+#define GOLDCPP_GRAMMARTABLES_H
+
+#include "String.h"
+#include "EGT.h"
+#include "Symbol.h"
+#include "FaState.h"
+#include "KeywordTable.h"
+#include "DfaOptimizer.h"
+#include "TableProfile.h"
+#include "MemoryUsage.h"
+#include "CharacterSet.h"
+#include "Production.h"
+#include "LrState.h"
+#include "Group.h"
+#include "CharScan.h"
+#include "StringPool.h"
+#include <vector>
+#include <cstdint>
+
+namespace GoldCPP
+{
+  class GrammarProperties
+  {
+
+  private:
+    #define GOLD_CPP_GRAMMAR_PROPERTY_COUNT 8
+    GPSTR_T _Properties[GOLD_CPP_GRAMMAR_PROPERTY_COUNT];
+
+  public:
+    enum PropertyIndex
+    {
+      PropName = 0,
+      PropVersion = 1,
+      PropAuthor = 2,
+      PropAbout = 3,
+      PropCharacterSet = 4,
+      PropCharacterMapping = 5,
+      PropGeneratedBy = 6,
+      PropGeneratedDate = 7
+    };
+
+    GPSTR_T getProperty(PropertyIndex index) const;
+    void setProperty(PropertyIndex index, const GPSTR_T &val);
+    size_t HeapBytes() const;
+  };
+
+  /* The tables of a grammar, as loaded from an EGT file, and what is derived
+  from them. Parsing only reads them, so once they are loaded and prepared
+  (see OptimizeDFA(), HashKeywords(), EliminateUnitProductions() and
+  ApplyProfile()), any number of Parsers can share them, in any number of
+  threads. See Parser::UseTables() and GrammarRegistry. Tokens and Reductions point into the tables, so these
+  must outlive the trees built with them. */
+  class GrammarTables
+  {
+    friend class Parser;
+
+  private:
+
+    // ===== Symbols recognized by the system
+    SymbolList SymbolTable_;
+    StringPool DisplayText_;      // Of symbols and productions, see Symbol::GetText()
+
+    // ===== DFA
+    FaStateList DFA_;
+    CharacterSetList CharSetTable_;
+    KeywordTable Keywords_;       // See HashKeywords()
+
+    /* A DFA path that can only ever produce a Noise token from a run of
+    characters: the initial state moves on 'First' to a state that accepts
+    a Noise symbol and whose only edge loops back on 'Rest'. */
+    struct NoiseRun
+    {
+      const CharacterSet *First;
+      SimpleCharSet Rest;
+    };
+    Vector<NoiseRun> NoiseRuns_;
+
+    // ===== Productions
+    ProductionList ProductionTable_;
+    TableVector<uint16_t> HandleIds_;       // Symbol ids of all handles, see Production::Handle
+
+    // ===== LALR
+    LRStateList LRStates_;
+
+    // ===== Lexical Groups
+    GroupList GroupTable_;
+
+    /* Characters that may start the End symbol of a group or the Start
+    symbol of a group nestable in it. Only used for groups that advance
+    by character, and only if the characters fit into a SimpleCharSet. */
+    struct GroupScan
+    {
+      bool Enabled;
+      SimpleCharSet Stops;
+
+      GroupScan() :
+        Enabled(false)
+      {}
+    };
+    Vector<GroupScan> GroupScans_;   // Indexed like GroupTable_
+
+    GrammarProperties Grammar_;
+    bool Loaded_;
+    EgtError LoadError_;            // Why Load() failed last
+
+    void FindNoiseRuns();
+    void FindGroupScans();
+
+#ifndef __GNUC__
+    GrammarTables(const GrammarTables& that){}
+#else
+    GrammarTables(const GrammarTables& that) = delete;
+#endif
+
+  public:
+
+    GrammarTables();
+
+    /* Frees all tables. */
+    void Clear();
+
+    /* Loads tables from EGT (version 5.0) data, replacing these. Every index
+    is checked against the table it points into, so damaged or hostile data
+    fails with an error in GetLoadError() rather than corrupting memory. On
+    failure, no tables are left loaded. */
+    bool Load(const uint8_t* binstream, size_t len);
+
+    /* Returns true if tables were loaded. */
+    bool Loaded() const
+    {
+      return Loaded_;
+    }
+
+    /* Writes the tables as they are now, prepared or not, in the EGT format,
+    so that Load() gives the same tables again without preparing them. Keywords
+    taken out by HashKeywords() are kept in records of GoldCPP's own, so other
+    GOLD engines may not read the data. Returns false if there are no tables. */
+    bool Save(std::vector<uint8_t> &out) const;
+
+    /* What was wrong with the data the last Load() call failed on. */
+    const EgtError& GetLoadError() const
+    {
+      return LoadError_;
+    }
+
+    /* See Parser::OptimizeDFA(). */
+    void OptimizeDFA();
+
+    /* See Parser::HashKeywords(). */
+    size_t HashKeywords();
+
+    /* See Parser::ApplyProfile(). */
+    bool ApplyProfile(const TableProfile &profile);
+
+    /* See Parser::EliminateUnitProductions(). */
+    size_t EliminateUnitProductions();
+
+    /* Size of the DFA tables, such as before and after OptimizeDFA(). */
+    DfaStats GetDfaStats() const;
+
+    /* Memory used by the tables, see MemoryUsage.h. */
+    TableMemory GetMemory() const;
+
+    const GrammarProperties& GetGrammar() const
+    {
+      return Grammar_;
+    }
+
+    const SymbolList& GetSymbolTable() const
+    {
+      return SymbolTable_;
+    }
+
+    const ProductionList& GetProductionTable() const
+    {
+      return ProductionTable_;
+    }
+
+    const FaStateList& GetDFA() const
+    {
+      return DFA_;
+    }
+
+    const LRStateList& GetLRStates() const
+    {
+      return LRStates_;
+    }
+  };
+}
+
+#endif // GOLDCPP_GRAMMARTABLES_H
@@ -0,0 +1,260 @@
+#include "IncrementalLexer.h"
+#include "Parser.h"
+#include <vector>
+#include <algorithm>
+
+namespace GoldCPP
+{
+  IncrementalLexer::IncrementalLexer(Parser *parser, size_t interval) :
+    Parser_(parser),
+    Interval_(interval),
+    ShiftBy_(0),
+    CheckpointShiftBy_(0),
+    CheckpointIndexBy_(0)
+  {}
+
+  size_t IncrementalLexer::TokenBegin(size_t index) const
+  {
+    size_t begin = Tokens_[index]->Location.Begin;
+    return (index >= Tokens_.GetGap()) ? begin + ShiftBy_ : begin;
+  }
+
+  size_t IncrementalLexer::CheckpointOffset(size_t index) const
+  {
+    size_t offset = Checkpoints_[index].Offset;
+    return (index >= Checkpoints_.GetGap()) ? offset + CheckpointShiftBy_ : offset;
+  }
+
+  size_t IncrementalLexer::CheckpointReach(size_t index) const
+  {
+    size_t reach = Checkpoints_[index].Reach;
+    return (index >= Checkpoints_.GetGap()) ? reach + CheckpointShiftBy_ : reach;
+  }
+
+  void IncrementalLexer::MoveTokenGap(size_t index)
+  {
+    // The tokens the gap passes are moved to their location, or back from it
+    size_t gap = Tokens_.GetGap();
+    if (ShiftBy_ != 0)
+    {
+      for (size_t i = gap; i < index; ++i)
+        Tokens_[i]->Location = Tokens_[i]->Location.Shifted(ShiftBy_);
+      for (size_t i = index; i < gap; ++i)
+        Tokens_[i]->Location = Tokens_[i]->Location.Shifted(-ShiftBy_);
+    }
+
+    Tokens_.MoveGap(index);
+  }
+
+  void IncrementalLexer::MoveCheckpointGap(size_t index)
+  {
+    size_t gap = Checkpoints_.GetGap();
+    for (size_t i = gap; i < index; ++i)
+      ShiftCheckpoint(Checkpoints_[i], CheckpointShiftBy_, CheckpointIndexBy_);
+    for (size_t i = index; i < gap; ++i)
+      ShiftCheckpoint(Checkpoints_[i], -CheckpointShiftBy_, -CheckpointIndexBy_);
+
+    Checkpoints_.MoveGap(index);
+  }
+
+  void IncrementalLexer::ShiftCheckpoint(LexerCheckpoint &checkpoint, ptrdiff_t offsetBy, ptrdiff_t indexBy)
+  {
+    checkpoint.Offset += offsetBy;
+    checkpoint.TokenIndex += indexBy;
+    checkpoint.Reach += offsetBy;
+
+    // Groups open at a checkpoint behind an edit start behind it as well
+    for (size_t g = 0; g < checkpoint.Groups.size(); ++g)
+      checkpoint.Groups[g].second += offsetBy;
+  }
+
+  bool IncrementalLexer::Lex(const GPSTR_T &source)
+  {
+    Tokens_.Clear();
+    Checkpoints_.Clear();
+    ShiftBy_ = 0;
+    CheckpointShiftBy_ = 0;
+    CheckpointIndexBy_ = 0;
+
+    if (!Parser_->TablesLoaded())
+      return false;
+
+    Source_ = std::make_shared<SourceText>(GPSTR_T());
+    Source_->Refer(source);
+    Parser_->Open(Source_);
+
+    LexerCheckpointList checkpoints;
+    Parser_->RecordCheckpoints(&checkpoints, Interval_);
+
+    std::shared_ptr<Token> Read;
+    do
+    {
+      Read = Parser_->ReadToken();
+      Tokens_.Add(Read);
+    } while (Read->GetType() != Symbol::SymbolType::End);
+
+    Parser_->RecordCheckpoints(NULL, 0);
+    for (size_t i = 0; i < checkpoints.size(); ++i)
+      Checkpoints_.Add(checkpoints[i]);
+    return true;
+  }
+
+  bool IncrementalLexer::Update(const GPSTR_T &source, const TextEdit &edit, size_t *changedBegin, size_t *changedEnd)
+  {
+    if (Tokens_.Count() == 0)
+    {
+      bool ok = Lex(source);
+      if (changedBegin)
+        *changedBegin = 0;
+      if (changedEnd)
+        *changedEnd = Tokens_.Count();
+      return ok;
+    }
+
+    /* Start from the last checkpoint whose tokens did not look at the edited
+    text, or from the start of the text if there is none: the checkpoints
+    behind an edit at the start are moved along with it. */
+    size_t lo = 0, hi = Checkpoints_.Count();
+    while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (CheckpointReach(mid) <= edit.Offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    const size_t ci = (lo > 0) ? lo - 1 : 0;        // First checkpoint replaced
+
+    const LexerCheckpoint start = (lo > 0) ? GetCheckpoint(ci) : LexerCheckpoint();
+    const size_t first = start.TokenIndex;
+    const size_t editEnd = edit.Offset + edit.Removed;          // In the old text
+    const ptrdiff_t delta = (ptrdiff_t)edit.Inserted - (ptrdiff_t)edit.Removed;
+
+    LexerCheckpointList fresh;
+    Source_->Refer(source);
+    Parser_->Open(Source_);
+    Parser_->RecordCheckpoints(&fresh, Interval_);
+    Parser_->RestoreLexer(start);
+
+    /* Lex until a token is read at the new location of an old token behind
+    the edit, with the same symbol and length. The lexer is outside of any
+    group after each token, so it would read the same tokens from there on. */
+    std::vector<std::shared_ptr<Token>> lexed;
+    size_t j = first;           // Old token to compare with
+    while (true)
+    {
+      std::shared_ptr<Token> Read = Parser_->ReadToken();
+
+      while ((j < Tokens_.Count()) &&
+        ((TokenBegin(j) < editEnd) || (TokenBegin(j) + delta < Read->Location.Begin)))
+      {
+        ++j;
+      }
+
+      if ((j < Tokens_.Count()) && (TokenBegin(j) + delta == Read->Location.Begin))
+      {
+        const Token &old = *Tokens_[j];
+        if ((old.Parent == Read->Parent) && (old.Location.Length() == Read->Location.Length()))
+          break;
+      }
+
+      lexed.push_back(Read);
+      if (Read->GetType() == Symbol::SymbolType::End)
+      {
+        j = Tokens_.Count();
+        break;
+      }
+    }
+    Parser_->RecordCheckpoints(NULL, 0);
+
+    const bool synced = (j < Tokens_.Count());
+    const size_t syncOffset = synced ? TokenBegin(j) + delta : source.size();     // In the new text
+    const ptrdiff_t indexDelta = (ptrdiff_t)lexed.size() - (ptrdiff_t)(j - first);
+
+    // ===== Replace the tokens at the gap, the ones behind it are moved along with the edit
+    MoveTokenGap(first);
+    Tokens_.Erase(j - first);
+    for (size_t i = 0; i < lexed.size(); ++i)
+      Tokens_.Insert(lexed[i]);
+    ShiftBy_ += delta;
+
+    // ===== Checkpoints: the old ones up to the restart, the new ones, then the old ones from the synchronized token on
+    size_t keep = synced ? ci : Checkpoints_.Count();
+    while ((keep < Checkpoints_.Count()) &&
+      ((CheckpointOffset(keep) < editEnd) || (CheckpointOffset(keep) + delta < syncOffset)))
+    {
+      ++keep;
+    }
+
+    /* New checkpoints taken inside the synchronized token are covered by the
+    old ones. Those taken in front of it are not, such as the one lexing
+    started from when the first token read was synchronized already. */
+    size_t freshCount = 0;
+    while ((freshCount < fresh.size()) &&
+      ((fresh[freshCount].TokenIndex < first + lexed.size()) || (fresh[freshCount].Offset < syncOffset)))
+    {
+      ++freshCount;
+    }
+
+    MoveCheckpointGap(ci);
+    Checkpoints_.Erase(keep - ci);
+    for (size_t i = 0; i < freshCount; ++i)
+      Checkpoints_.Insert(fresh[i]);
+    CheckpointShiftBy_ += delta;
+    CheckpointIndexBy_ += indexDelta;
+
+    // The tokens lexed again may have looked further than the old ones did, past some of the checkpoints kept
+    const size_t reach = Parser_->GetLexReach();
+    for (size_t i = Checkpoints_.GetGap(); (i < Checkpoints_.Count()) && (CheckpointReach(i) < reach); ++i)
+      Checkpoints_[i].Reach = reach - CheckpointShiftBy_;
+
+    if (changedBegin)
+      *changedBegin = first;
+    if (changedEnd)
+      *changedEnd = first + lexed.size();
+    return true;
+  }
+
+  size_t IncrementalLexer::Count() const
+  {
+    return Tokens_.Count();
+  }
+
+  const std::shared_ptr<Token>& IncrementalLexer::GetToken(size_t index)
+  {
+    if (index >= Tokens_.GetGap())
+      MoveTokenGap(index + 1);
+
+    return Tokens_[index];
+  }
+
+  size_t IncrementalLexer::FindToken(size_t offset) const
+  {
+    // Binary search on the end of each token
+    size_t lo = 0, hi = Tokens_.Count();
+    while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      size_t end = TokenBegin(mid) + Tokens_[mid]->Location.Length();
+      if (end <= offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    return lo;
+  }
+
+  size_t IncrementalLexer::CheckpointCount() const
+  {
+    return Checkpoints_.Count();
+  }
+
+  LexerCheckpoint IncrementalLexer::GetCheckpoint(size_t index) const
+  {
+    LexerCheckpoint checkpoint = Checkpoints_[index];
+    if (index >= Checkpoints_.GetGap())
+      ShiftCheckpoint(checkpoint, CheckpointShiftBy_, CheckpointIndexBy_);
+    return checkpoint;
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef GOLDCPP_INCREMENTALLEXER_H
+#define GOLDCPP_INCREMENTALLEXER_H
+
+#include "Token.h"
+#include "TextEdit.h"
+#include "LexerCheckpoint.h"
+#include "GapBuffer.h"
+#include <memory>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  class Parser;
+
+  /* Keeps the full token stream of a text (Noise, groups and the final End
+  token included, as returned by Parser::ReadToken()) up to date while the
+  text is being edited, such as for syntax highlighting.
+
+  Lexer checkpoints are recorded while lexing. After an edit, lexing starts
+  again from a checkpoint before the edit and stops as soon as a token
+  behind the edit is read again unchanged. The tokens and checkpoints are
+  kept in gap buffers with the gap at the last edit. Those behind the gap
+  keep their locations from before the edits, which are corrected by a
+  single delta when read, so an edit only moves the tokens and checkpoints
+  between it and the previous edit (or the last token asked for).
+
+  The text is read where the caller keeps it, without copying it (see
+  SourceText::Refer()). It must stay as it is until the next update, and
+  for as long as the positions of the tokens are looked up.
+
+  The Parser must have its tables loaded. It is used for lexing only and
+  reads the latest text, so it should not be used for parsing meanwhile.
+  Its SkipNoiseRuns setting must not be changed between updates. */
+  class IncrementalLexer
+  {
+  private:
+    Parser *Parser_;
+    size_t Interval_;
+    std::shared_ptr<SourceText> Source_;    // Refers to the latest text, for the tokens
+
+    GapBuffer<std::shared_ptr<Token>> Tokens_;
+    ptrdiff_t ShiftBy_;                     // Of the tokens behind the gap
+
+    GapBuffer<LexerCheckpoint> Checkpoints_;
+    ptrdiff_t CheckpointShiftBy_;           // Of the offsets behind the gap
+    ptrdiff_t CheckpointIndexBy_;           // Of the token indices behind the gap
+
+    size_t TokenBegin(size_t index) const;
+    size_t CheckpointOffset(size_t index) const;
+    size_t CheckpointReach(size_t index) const;
+    void MoveTokenGap(size_t index);
+    void MoveCheckpointGap(size_t index);
+    static void ShiftCheckpoint(LexerCheckpoint &checkpoint, ptrdiff_t offsetBy, ptrdiff_t indexBy);
+
+#ifndef __GNUC__
+    IncrementalLexer(const IncrementalLexer& that){}
+#else
+    IncrementalLexer(const IncrementalLexer& that) = delete;
+#endif
+
+  public:
+
+    /* Records a checkpoint about every 'interval' characters. */
+    explicit IncrementalLexer(Parser *parser, size_t interval = 1024);
+
+    /* Lexes all of 'source'. Returns false if no tables are loaded. */
+    bool Lex(const GPSTR_T &source);
+
+    /* Updates the tokens after 'edit' was made to the text, which is now
+    'source'. That may be the same string as before, changed in place. On
+    return, tokens [*changedBegin, *changedEnd) are new, all others were
+    kept. Lexes everything if nothing was lexed yet. */
+    bool Update(const GPSTR_T &source, const TextEdit &edit, size_t *changedBegin = NULL, size_t *changedEnd = NULL);
+
+    size_t Count() const;
+
+    /* Token at 'index', with its location in the current text. */
+    const std::shared_ptr<Token>& GetToken(size_t index);
+
+    /* Index of the token containing 'offset', or of the first token behind it. */
+    size_t FindToken(size_t offset) const;
+
+    size_t CheckpointCount() const;
+
+    /* Checkpoint at 'index', with its offsets in the current text. */
+    LexerCheckpoint GetCheckpoint(size_t index) const;
+  };
+}
+
+#endif // GOLDCPP_INCREMENTALLEXER_H
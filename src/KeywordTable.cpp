@@ -0,0 +1,401 @@
+#include "KeywordTable.h"
+#include "CharacterSet.h"
+#include "MemoryUsage.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace GoldCPP
+{
+  static const uint32_t kMaxSeed = 1u << 16;
+
+  namespace
+  {
+    struct Candidate
+    {
+      Symbol *Keyword;
+      uint16_t Accept;      // The only state accepting Keyword
+      GPSTR_T Text;         // With letters in lower case if they match in any case
+      bool Exact;           // Matches in the case of Text only
+      bool AnyCase;         // Matches in any case
+    };
+
+    struct BucketLarger
+    {
+      const std::vector<std::vector<size_t>> *Buckets;
+
+      bool operator()(size_t a, size_t b) const
+      {
+        return (*Buckets)[a].size() > (*Buckets)[b].size();
+      }
+    };
+  }
+
+  void KeywordTable::Clear()
+  {
+    Slots_.clear();
+    Seeds_.clear();
+    Identifiers_.clear();
+    Count_ = 0;
+    IgnoreCase_ = false;
+  }
+
+  size_t KeywordTable::HeapBytes() const
+  {
+    size_t bytes = GoldCPP::HeapBytes(Slots_) + GoldCPP::HeapBytes(Seeds_) + GoldCPP::HeapBytes(Identifiers_);
+    for (size_t i = 0; i < Slots_.size(); ++i)
+      bytes += GoldCPP::HeapBytes(Slots_[i].Text);
+    return bytes;
+  }
+
+  GPCHR_T KeywordTable::OtherCase(GPCHR_T c)
+  {
+    if ((c >= 'A') && (c <= 'Z'))
+      return c + ('a' - 'A');
+    if ((c >= 'a') && (c <= 'z'))
+      return c - ('a' - 'A');
+    return c;
+  }
+
+  GPCHR_T KeywordTable::LowerCase(GPCHR_T c)
+  {
+    return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+  }
+
+  uint64_t KeywordTable::Hash(const GPCHR_T *text, size_t len, bool ignoreCase)
+  {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i)
+    {
+      h ^= (uint64_t)(ignoreCase ? LowerCase(text[i]) : text[i]);
+      h *= 1099511628211ull;
+    }
+
+    return h;
+  }
+
+  size_t KeywordTable::SlotOf(uint64_t hash, uint32_t seed, size_t mask)
+  {
+    uint64_t h = hash ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 29;
+    return (size_t)h & mask;
+  }
+
+  bool KeywordTable::Build(const std::vector<Entry> &entries)
+  {
+    size_t n = entries.size();
+    size_t numSlots = 1;
+    while (numSlots < 2*n)
+      numSlots <<= 1;
+    size_t numBuckets = 1;
+    while (numBuckets*4 < n)
+      numBuckets <<= 1;
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::vector<size_t>> buckets(numBuckets);
+    for (size_t i = 0; i < n; ++i)
+    {
+      hashes[i] = Hash(entries[i].Text.data(), entries[i].Text.size(), IgnoreCase_);
+      buckets[hashes[i] & (numBuckets-1)].push_back(i);
+    }
+
+    // Place the largest buckets first, while there is the most room
+    std::vector<size_t> order(numBuckets);
+    for (size_t b = 0; b < numBuckets; ++b)
+      order[b] = b;
+    BucketLarger larger = { &buckets };
+    std::stable_sort(order.begin(), order.end(), larger);
+
+    Slots_.assign(numSlots, Entry());
+    Seeds_.assign(numBuckets, 0);
+    std::vector<size_t> taken;
+    for (size_t o = 0; o < numBuckets; ++o)
+    {
+      const std::vector<size_t> &bucket = buckets[order[o]];
+      if (bucket.empty())
+        break;
+
+      bool placed = false;
+      uint32_t seed = 0;
+      for (; (seed < kMaxSeed) && !placed; ++seed)
+      {
+        placed = true;
+        taken.clear();
+        for (size_t k = 0; (k < bucket.size()) && placed; ++k)
+        {
+          size_t slot = SlotOf(hashes[bucket[k]], seed, numSlots-1);
+          if ((Slots_[slot].Keyword != NULL) || (std::find(taken.begin(), taken.end(), slot) != taken.end()))
+            placed = false;
+          else
+            taken.push_back(slot);
+        }
+      }
+
+      if (!placed)    // Only if two texts have the same hash
+      {
+        Slots_.clear();
+        Seeds_.clear();
+        return false;
+      }
+
+      Seeds_[order[o]] = seed - 1;
+      for (size_t k = 0; k < bucket.size(); ++k)
+        Slots_[taken[k]] = entries[bucket[k]];
+    }
+
+    return true;
+  }
+
+  Symbol* KeywordTable::Lookup(Symbol *accepted, const GPSTR_T &text) const
+  {
+    uint64_t h = Hash(text.data(), text.size(), IgnoreCase_);
+    const Entry &entry = Slots_[SlotOf(h, Seeds_[h & (Seeds_.size()-1)], Slots_.size()-1)];
+    if ((entry.Identifier != accepted) || (entry.Text.size() != text.size()))
+      return accepted;
+
+    if (!IgnoreCase_)
+      return (entry.Text == text) ? entry.Keyword : accepted;
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+      if (LowerCase(entry.Text[i]) != LowerCase(text[i]))
+        return accepted;
+    }
+    return entry.Keyword;
+  }
+
+  size_t KeywordTable::Extract(FaStateList &dfa)
+  {
+    Clear();
+
+    size_t numStates = dfa.Count();
+    if (numStates == 0)
+      return 0;
+
+    // Symbols accepted by a single state are candidates
+    std::unordered_map<Symbol*, int> acceptedBy;     // -1 if by more than one state
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      Symbol *accept = dfa[i].Accept;
+      if ((accept == NULL) || (accept->Type != Symbol::SymbolType::Content) || (accept->GoldGroup != NULL))
+        continue;
+
+      std::unordered_map<Symbol*, int>::iterator it = acceptedBy.find(accept);
+      if (it == acceptedBy.end())
+        acceptedBy[accept] = (int)i;
+      else
+        it->second = -1;
+    }
+
+    /* Identifiers match texts of more than one length, so some state
+    accepting them leads on to another one that does. */
+    std::vector<std::vector<uint16_t>> sources(numStates);
+    std::vector<bool> isVariable;
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      Symbol *accept = dfa[i].Accept;
+      for (size_t n = 0; n < dfa[i].Edges.Count(); ++n)
+      {
+        uint16_t target = dfa[i].Edges[n].Target;
+        sources[target].push_back((uint16_t)i);
+        if ((accept != NULL) && (dfa[target].Accept == accept))
+        {
+          if (isVariable.size() <= accept->TableIndex)
+            isVariable.resize(accept->TableIndex + 1, false);
+          isVariable[accept->TableIndex] = true;
+        }
+      }
+    }
+
+    /* The candidate matches a single literal if the states that can reach
+    its accept state form a chain of single character edges from the
+    initial state, with no way back from the accept state. An edge on both
+    cases of a letter is taken as a single character that matches in any
+    case. */
+    std::vector<Candidate> literals;
+    std::vector<bool> isLiteral;
+    std::vector<bool> reaches(numStates);
+    std::vector<uint16_t> pending;
+    for (size_t i = 0; i < numStates; ++i)
+    {
+      std::unordered_map<Symbol*, int>::const_iterator it = acceptedBy.find(dfa[i].Accept);
+      if ((it == acceptedBy.end()) || (it->second != (int)i))
+        continue;
+
+      uint16_t accept = (uint16_t)i;
+      std::fill(reaches.begin(), reaches.end(), false);
+      reaches[accept] = true;
+      pending.assign(1, accept);
+      while (!pending.empty())
+      {
+        uint16_t state = pending.back();
+        pending.pop_back();
+        for (size_t n = 0; n < sources[state].size(); ++n)
+        {
+          uint16_t source = sources[state][n];
+          if (!reaches[source])
+          {
+            reaches[source] = true;
+            pending.push_back(source);
+          }
+        }
+      }
+
+      Candidate c;
+      c.Keyword = it->first;
+      c.Accept = accept;
+      c.Exact = true;
+      c.AnyCase = true;
+      uint16_t state = dfa.InitialState;
+      bool single = reaches[state] && (state != accept);
+      while (single && (state != accept))
+      {
+        const FaEdge *next = NULL;
+        bool bothCases = false;
+        const FaEdgeList &edges = dfa[state].Edges;
+        for (size_t n = 0; (n < edges.Count()) && single; ++n)
+        {
+          if (!reaches[edges[n].Target])
+            continue;
+
+          const CharacterSet &chars = *(edges[n].Characters);
+          bool one = (chars.Count() == 1) && (chars[0].Start == chars[0].End);
+          bothCases = (chars.Count() == 2) && (chars[0].Start == chars[0].End) && (chars[1].Start == chars[1].End)
+            && (chars[0].Start != chars[1].Start) && (OtherCase((GPCHR_T)chars[0].Start) == (GPCHR_T)chars[1].Start);
+          single = (next == NULL) && (one || bothCases);
+          next = &edges[n];
+        }
+
+        // Longer than the number of states means there is a loop
+        single = single && (next != NULL) && (c.Text.size() < numStates);
+        if (single)
+        {
+          GPCHR_T ch = (GPCHR_T)next->Characters->GetItemAt(0).Start;
+          if (bothCases)
+            c.Exact = false;
+          else if (OtherCase(ch) != ch)
+            c.AnyCase = false;
+          c.Text.push_back(bothCases ? LowerCase(ch) : ch);
+          state = next->Target;
+        }
+      }
+
+      const FaEdgeList &edges = dfa[accept].Edges;
+      for (size_t n = 0; (n < edges.Count()) && single; ++n)
+        single = !reaches[edges[n].Target];
+
+      if (single)
+      {
+        if (isLiteral.size() <= c.Keyword->TableIndex)
+          isLiteral.resize(c.Keyword->TableIndex + 1, false);
+        isLiteral[c.Keyword->TableIndex] = true;
+        literals.push_back(c);
+      }
+    }
+
+    // The table either ignores case or not, whichever more literals allow
+    size_t exact = 0, anyCase = 0;
+    for (size_t k = 0; k < literals.size(); ++k)
+    {
+      exact += literals[k].Exact ? 1 : 0;
+      anyCase += literals[k].AnyCase ? 1 : 0;
+    }
+    bool ignoreCase = (anyCase > exact);
+
+    /* The identifier is what most of the states following the keyword accept.
+    Keywords that only lead on to other literals, such as '<' to '<=', are
+    left in the DFA. */
+    std::vector<Entry> entries;
+    std::vector<uint16_t> acceptStates;
+    for (size_t k = 0; k < literals.size(); ++k)
+    {
+      const Candidate &c = literals[k];
+      if (!(ignoreCase ? c.AnyCase : c.Exact))
+        continue;
+
+      std::unordered_map<Symbol*, size_t> votes;
+      const FaEdgeList &edges = dfa[c.Accept].Edges;
+      for (size_t n = 0; n < edges.Count(); ++n)
+        ++votes[dfa[edges[n].Target].Accept];
+
+      Symbol *identifier = NULL;
+      size_t best = 0;
+      for (std::unordered_map<Symbol*, size_t>::const_iterator it = votes.begin(); it != votes.end(); ++it)
+      {
+        Symbol *sym = it->first;
+        if ((sym == NULL) || (sym->Type != Symbol::SymbolType::Content) || (sym->GoldGroup != NULL))
+          continue;
+        if ((sym->TableIndex < isLiteral.size()) && isLiteral[sym->TableIndex])
+          continue;
+        if ((sym->TableIndex >= isVariable.size()) || !isVariable[sym->TableIndex])
+          continue;
+
+        if ((identifier == NULL) || (it->second > best) ||
+            ((it->second == best) && (sym->TableIndex < identifier->TableIndex)))
+        {
+          identifier = sym;
+          best = it->second;
+        }
+      }
+
+      if (identifier != NULL)
+      {
+        entries.push_back(Entry(c.Text, identifier, c.Keyword, ignoreCase));
+        acceptStates.push_back(c.Accept);
+      }
+    }
+
+    if (entries.empty() || !Restore(entries))
+      return 0;
+
+    for (size_t e = 0; e < entries.size(); ++e)
+      dfa[acceptStates[e]].Accept = entries[e].Identifier;
+
+    return Count_;
+  }
+
+  bool KeywordTable::Restore(const std::vector<Entry> &entries)
+  {
+    Clear();
+    if (entries.empty())
+      return true;
+
+    IgnoreCase_ = entries[0].IgnoreCase;
+    for (size_t e = 1; e < entries.size(); ++e)
+    {
+      if (entries[e].IgnoreCase != IgnoreCase_)
+      {
+        Clear();
+        return false;
+      }
+    }
+    if (!Build(entries))
+    {
+      Clear();
+      return false;
+    }
+
+    for (size_t e = 0; e < entries.size(); ++e)
+    {
+      Symbol *identifier = entries[e].Identifier;
+      if (Identifiers_.size() <= identifier->TableIndex)
+        Identifiers_.resize(identifier->TableIndex + 1, false);
+      Identifiers_[identifier->TableIndex] = true;
+    }
+
+    Count_ = entries.size();
+    return true;
+  }
+
+  void KeywordTable::GetEntries(std::vector<Entry> &out) const
+  {
+    out.clear();
+    for (size_t i = 0; i < Slots_.size(); ++i)
+    {
+      if (Slots_[i].Keyword != NULL)
+        out.push_back(Slots_[i]);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef GOLDCPP_KEYWORDTABLE_H
+#define GOLDCPP_KEYWORDTABLE_H
+
+#include "String.h"
+#include "Symbol.h"
+#include "FaState.h"
+#include "TableAllocator.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Recognizes keywords by a perfect hash of the token text, instead of by
+  DFA states of their own (see Parser::HashKeywords()). The DFA accepts a
+  keyword as the terminal its path would otherwise lead to, usually an
+  identifier, and Classify() turns it back into the keyword. Keywords of
+  case insensitive grammars are hashed and compared with their ASCII
+  letters in lower case. */
+  class KeywordTable
+  {
+  public:
+    struct Entry
+    {
+      GPSTR_T Text;
+      Symbol *Identifier;       // What the DFA accepts the text as
+      Symbol *Keyword;          // NULL for an empty slot
+      bool IgnoreCase;          // Text is in lower case, and matches in any case
+
+      Entry() :
+        Identifier(NULL), Keyword(NULL), IgnoreCase(false)
+      {}
+
+      Entry(const GPSTR_T &text, Symbol *identifier, Symbol *keyword, bool ignoreCase = false) :
+        Text(text), Identifier(identifier), Keyword(keyword), IgnoreCase(ignoreCase)
+      {}
+    };
+
+  private:
+    /* Hash and displace: a key's bucket picks the seed that places it in
+    Slots_, chosen so that no two keys share a slot. */
+    TableVector<Entry> Slots_;
+    TableVector<uint32_t> Seeds_;       // Per bucket
+    TableVector<bool> Identifiers_;     // Indexed by Symbol::TableIndex
+    size_t Count_;
+    bool IgnoreCase_;                   // Of all entries
+
+    static GPCHR_T OtherCase(GPCHR_T c);
+    static GPCHR_T LowerCase(GPCHR_T c);
+    static uint64_t Hash(const GPCHR_T *text, size_t len, bool ignoreCase);
+    static size_t SlotOf(uint64_t hash, uint32_t seed, size_t mask);
+    bool Build(const std::vector<Entry> &entries);
+    Symbol* Lookup(Symbol *accepted, const GPSTR_T &text) const;
+
+  public:
+
+    KeywordTable() :
+      Count_(0), IgnoreCase_(false)
+    {}
+
+    void Clear();
+
+    /* Finds keywords in 'dfa', and if they can all be hashed, changes their
+    accept states to accept the identifier instead. A keyword is a Content
+    symbol outside of groups that only matches a single literal string, and
+    whose accept state leads on to the states of an identifier: another
+    Content symbol, which matches texts of more than one length. Literals
+    that only lead on to other literals, such as operators, stay in the DFA.
+    In a case insensitive grammar, each ASCII letter of a literal is an edge
+    on both of its cases, and such a chain is taken as one literal as well.
+    The table hashes either these or case sensitive literals, whichever are
+    more; the others stay in the DFA. Returns the number of keywords. */
+    size_t Extract(FaStateList &dfa);
+
+    /* Sets up the table for keywords taken out of a DFA before, such as
+    by Extract() in tables that were saved. Leaves the table empty and
+    returns false if they cannot be hashed, or if some ignore case and
+    others do not. */
+    bool Restore(const std::vector<Entry> &entries);
+
+    /* The keywords, in no particular order. */
+    void GetEntries(std::vector<Entry> &out) const;
+
+    size_t Count() const
+    {
+      return Count_;
+    }
+
+    size_t HeapBytes() const;
+
+    /* The keyword that 'text' is, if the DFA accepted it as 'accepted'.
+    Otherwise returns 'accepted'. */
+    Symbol* Classify(Symbol *accepted, const GPSTR_T &text) const
+    {
+      if ((accepted->TableIndex >= Identifiers_.size()) || !Identifiers_[accepted->TableIndex])
+        return accepted;
+
+      return Lookup(accepted, text);
+    }
+  };
+}
+
+#endif // GOLDCPP_KEYWORDTABLE_H
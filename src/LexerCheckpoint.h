@@ -0,0 +1,34 @@
+#ifndef GOLDCPP_LEXERCHECKPOINT_H
+#define GOLDCPP_LEXERCHECKPOINT_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  struct Symbol;
+
+  /* Everything the lexer needs to continue from some offset of a text:
+  the groups open at that offset, each with its start symbol and start
+  offset. The DFA always starts from its initial state, and the text of the
+  open groups is taken from the source again, so nothing else is stored.
+  The tokens read before the checkpoint are only the same on an edited text
+  if the edit is at or behind Reach, as the DFA may have looked past the
+  end of the last one. */
+  struct LexerCheckpoint
+  {
+    size_t Offset;
+    size_t TokenIndex;    // Number of tokens read before this checkpoint
+    size_t Reach;         // One past the furthest character looked at before this checkpoint
+    std::vector<std::pair<const Symbol*, size_t>> Groups;   // Bottom of the group stack first
+
+    LexerCheckpoint()
+      : Offset(0), TokenIndex(0), Reach(0), Groups()
+    {}
+  };
+
+  typedef std::vector<LexerCheckpoint> LexerCheckpointList;
+}
+
+#endif // GOLDCPP_LEXERCHECKPOINT_H
@@ -0,0 +1,54 @@
+#include "LineIndex.h"
+#include <algorithm>
+
+namespace GoldCPP
+{
+  LineIndex::LineIndex()
+  {
+    CharacterSet lf;
+    lf.Add(CharacterRange(10, 10));
+    LineFeed_.Assign(lf);
+
+    Clear();
+  }
+
+  void LineIndex::Clear()
+  {
+    LineStarts_.assign(1, 0);
+    Scanned_ = 0;
+  }
+
+  Position LineIndex::Lookup(const GPSTR_T &text, size_t offset)
+  {
+    if (offset > text.size())
+      offset = text.size();
+
+    // Extend the index up to the requested offset
+    while (Scanned_ < offset)
+    {
+      size_t lf = Scanned_ + LineFeed_.FindFirst(text.data() + Scanned_, offset - Scanned_);
+      if (lf < offset)
+      {
+        LineStarts_.push_back(lf + 1);
+        Scanned_ = lf + 1;
+      }
+      else
+      {
+        Scanned_ = offset;
+      }
+    }
+
+    // Find the last line starting at or before the offset
+    std::vector<size_t>::const_iterator line = std::upper_bound(LineStarts_.begin(), LineStarts_.end(), offset) - 1;
+
+    Position pos;
+    pos.Line = (uint32_t)(line - LineStarts_.begin());
+    for (size_t i = *line; i < offset; ++i)
+    {
+      if (text[i] != 13)   // CR is ignored, LF is used to increment line to be UNIX friendly
+        pos.Column += 1;
+    }
+
+    return pos;
+  }
+}
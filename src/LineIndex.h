@@ -0,0 +1,38 @@
+#ifndef GOLDCPP_LINEINDEX_H
+#define GOLDCPP_LINEINDEX_H
+
+#include "String.h"
+#include "Position.h"
+#include "CharScan.h"
+#include <vector>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Converts character offsets in a text into line and column numbers.
+  The offsets of line starts are collected lazily, only as far into the text
+  as the largest offset looked up so far.
+  Lines are ended by LF, and CR characters are not counted in columns, just
+  like the lexer used to do while consuming input. Not thread safe, see
+  SourceText. */
+  class LineIndex
+  {
+  private:
+    std::vector<size_t> LineStarts_;
+    size_t Scanned_;              // Text before this offset is indexed
+    SimpleCharSet LineFeed_;
+
+  public:
+
+    LineIndex();
+
+    /* Forgets everything indexed so far. Must be called when the text changes. */
+    void Clear();
+
+    /* Returns the position of 'offset' in 'text'. Offsets past the end of
+    the text are treated as the end of the text. */
+    Position Lookup(const GPSTR_T &text, size_t offset);
+  };
+}
+
+#endif // GOLDCPP_LINEINDEX_H
@@ -1,7 +1,55 @@
 #include "LrState.h"
+#include "Symbol.h"
+#include "Production.h"
+#include <algorithm>
+#include <map>
 
 namespace GoldCPP
 {
+  namespace
+  {
+    struct CountLarger
+    {
+      const std::vector<uint64_t> *Counts;
+
+      bool operator()(size_t a, size_t b) const
+      {
+        return (*Counts)[a] > (*Counts)[b];
+      }
+    };
+
+    typedef std::vector<LRAction> GotoList;
+
+    const uint16_t kNoState = (uint16_t)-1;
+
+    uint16_t FindGoto(const GotoList &gotos, const Symbol *sym)
+    {
+      for (size_t i = 0; i < gotos.size(); ++i)
+      {
+        if (gotos[i].Sym == sym)
+          return gotos[i].Value;
+      }
+
+      return kNoState;
+    }
+
+    /* Adds 'from' to 'to'. Returns false if they go to different states on
+    the same symbol. */
+    bool MergeGotos(GotoList &to, const GotoList &from)
+    {
+      for (size_t i = 0; i < from.size(); ++i)
+      {
+        uint16_t target = FindGoto(to, from[i].Sym);
+        if (target == kNoState)
+          to.push_back(from[i]);
+        else if (target != from[i].Value)
+          return false;
+      }
+
+      return true;
+    }
+  }
+
   size_t LRState::FindActionForSymbol(const Symbol *sym) const
   {
     size_t numItems = Actions.Count();
@@ -24,4 +72,194 @@ namespace GoldCPP
     else
       return NULL;
   }
+
+  void LRState::FindExpected()
+  {
+    Expected.Clear();
+    for (size_t i = 0; i < Actions.Count(); ++i)
+    {
+      const Symbol *sym = Actions[i].Sym;
+      switch (sym->Type)
+      {
+        case Symbol::SymbolType::Content:
+        case Symbol::SymbolType::End:
+        case Symbol::SymbolType::GroupStart:
+        case Symbol::SymbolType::GroupEnd:
+          Expected.Add(sym->TableIndex);
+        default:
+          break;
+      }
+    }
+  }
+
+  void LRState::SortActions(const std::vector<uint64_t> &actionCounts)
+  {
+    std::vector<size_t> order(Actions.Count());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+
+    CountLarger larger = { &actionCounts };
+    std::stable_sort(order.begin(), order.end(), larger);
+
+    Vector<LRAction> sorted;
+    sorted.Reserve(Actions.Count());
+    for (size_t i = 0; i < order.size(); ++i)
+      sorted.Add(Actions[order[i]]);
+    Actions = sorted;
+  }
+
+  void LRStateList::Reorder(const std::vector<uint64_t> &stateCounts)
+  {
+    size_t numStates = Count();
+    std::vector<size_t> order(numStates);
+    for (size_t i = 0; i < numStates; ++i)
+      order[i] = i;
+
+    CountLarger larger = { &stateCounts };
+    std::stable_sort(order.begin(), order.end(), larger);
+
+    std::vector<uint16_t> newIndex(numStates);
+    for (size_t s = 0; s < numStates; ++s)
+      newIndex[order[s]] = (uint16_t)s;
+
+    LRStateList states(numStates);
+    states.InitialState = newIndex[InitialState];
+    for (size_t s = 0; s < numStates; ++s)
+    {
+      states[s] = GetItemAt(order[s]);
+      Vector<LRAction> &actions = states[s].Actions;
+      for (size_t n = 0; n < actions.Count(); ++n)
+      {
+        if ((actions[n].Type == LRActionType::Shift) || (actions[n].Type == LRActionType::Goto))
+          actions[n].Value = newIndex[actions[n].Value];
+      }
+    }
+
+    *this = states;
+  }
+
+  size_t LRStateList::EliminateUnitProductions(const ProductionList &productions)
+  {
+    /* When the parser goes to state T on a nonterminal <B> from state S, and
+    T reduces by <A> ::= <B> on the lookahead, the <B> on the stack is only
+    relabeled: the parser goes to state S on <A> next, and maybe reduces by
+    another unit production there, until it comes to a state F that does
+    something else on the lookahead. This depends on S and the lookahead only,
+    so S can go to a copy of T instead, which does what F does on each such
+    lookahead right away. Afterwards, the copy stands in for F on the stack,
+    so it also gets the gotos of every F, unless they clash with those of T.
+    Lookaheads F has no action for keep the unit reduction, so errors are
+    still found in the same place.
+    Copies are shared by all gotos that lead to the same one. Their own gotos
+    are shortcut as well, so a copy may be made of a copy. */
+
+    LRStateList original = *this;
+    size_t numOriginal = Count();
+
+    // Gotos of the states as they were, which are followed to find F
+    std::vector<GotoList> gotos(numOriginal);
+    for (size_t s = 0; s < numOriginal; ++s)
+    {
+      const Vector<LRAction> &actions = original[s].Actions;
+      for (size_t n = 0; n < actions.Count(); ++n)
+      {
+        if (actions[n].Type == LRActionType::Goto)
+          gotos[s].push_back(actions[n]);
+      }
+    }
+
+    std::map<std::vector<uintptr_t>, uint16_t> copies;    // By their actions
+    size_t changed = 0;
+
+    for (size_t s = 0; s < Count(); ++s)
+    {
+      for (size_t g = 0; g < gotos[s].size(); ++g)
+      {
+        uint16_t target = gotos[s][g].Value;
+        const Vector<LRAction> &actions = original[target].Actions;
+
+        Vector<LRAction> shortcut;
+        GotoList copyGotos = gotos[target];
+        bool merged = true;
+        bool found = false;
+
+        for (size_t n = 0; (n < actions.Count()) && merged; ++n)
+        {
+          const LRAction &action = actions[n];
+          if (action.Type == LRActionType::Goto)
+            continue;
+
+          // Follow the unit reductions on this lookahead
+          const LRAction *result = &action;
+          uint16_t state = target;
+          size_t steps = 0;
+          while (result && (result->Type == LRActionType::Reduce) && productions[result->Value].ContainsOneNonTerminal() &&
+                 (steps++ < productions.Count()))
+          {
+            state = FindGoto(gotos[s], productions[result->Value].Head);
+            result = (state != kNoState) ? original[state].GetActionForSymbol(action.Sym) : NULL;
+          }
+
+          if (!result || (state == target) || ((result->Type == LRActionType::Reduce) && productions[result->Value].ContainsOneNonTerminal()))
+            shortcut.Add(action);
+          else
+          {
+            shortcut.Add(LRAction(action.Sym, result->Type, result->Value));
+            merged = MergeGotos(copyGotos, gotos[state]);
+            found = true;
+          }
+        }
+
+        if (!found || !merged)
+          continue;
+
+        // Shortcut gotos of the copy are found when we get to it
+        std::vector<uintptr_t> key;
+        for (size_t n = 0; n < shortcut.Count(); ++n)
+        {
+          key.push_back((uintptr_t)shortcut[n].Sym);
+          key.push_back(((uintptr_t)shortcut[n].Type << 16) | shortcut[n].Value);
+        }
+        for (size_t n = 0; n < copyGotos.size(); ++n)
+        {
+          key.push_back((uintptr_t)copyGotos[n].Sym);
+          key.push_back(copyGotos[n].Value);
+        }
+
+        std::map<std::vector<uintptr_t>, uint16_t>::const_iterator it = copies.find(key);
+        uint16_t copy;
+        if (it != copies.end())
+          copy = it->second;
+        else
+        {
+          if (Count() >= kNoState)
+          {
+            // Too many states for the tables, leave them as they were
+            *this = original;
+            return 0;
+          }
+
+          copy = (uint16_t)Count();
+          LRState state;
+          state.Actions = shortcut;
+          for (size_t n = 0; n < copyGotos.size(); ++n)
+            state.Actions.Add(copyGotos[n]);
+          state.FindExpected();
+          Add(state);
+          gotos.push_back(copyGotos);
+          copies[key] = copy;
+        }
+
+        Vector<LRAction> &own = GetItemAt(s).Actions;
+        for (size_t n = 0; n < own.Count(); ++n)
+        {
+          if ((own[n].Type == LRActionType::Goto) && (own[n].Sym == gotos[s][g].Sym))
+            own[n].Value = copy;
+        }
+        ++changed;
+      }
+    }
+
+    return changed;
+  }
 }
@@ -2,11 +2,15 @@
 #define GOLDCPP_LRSTATE_H
 
 #include "Vector.h"
+#include "SymbolIdSet.h"
+#include <vector>
 #include <cstdint>
 
 namespace GoldCPP
 {
   struct Symbol;
+  struct Production;
+  typedef Vector<Production> ProductionList;
 
   enum class LRConflict
   {
@@ -47,10 +51,22 @@ namespace GoldCPP
 
     Vector<LRAction> Actions;
 
+    /* Terminals this state has an action for, to tell what was expected on
+    a syntax error. See FindExpected(). */
+    SymbolIdSet Expected;
+
     /* This function replaces the subscript overload of the .NET implementation
     which is indexed by the Symbol */
     const LRAction* GetActionForSymbol(const Symbol *sym) const;
 
+    /* Fills Expected from Actions. */
+    void FindExpected();
+
+    /* Sorts Actions by descending count, such as of their use, so the most
+    used are found first. Actions are for distinct symbols, so their order
+    does not change what the state does. */
+    void SortActions(const std::vector<uint64_t> &actionCounts);
+
   private:
 
     size_t FindActionForSymbol(const Symbol *sym) const;
@@ -68,11 +84,20 @@ namespace GoldCPP
       InitialState(0)
     {}
 
-    virtual void Clear()
+    void Clear()
     {
       InitialState = 0;
       Vector<LRState>::Clear();
     }
+
+    /* Numbers the states by descending count, such as of their visits, and
+    updates the actions going to them. */
+    void Reorder(const std::vector<uint64_t> &stateCounts);
+
+    /* Takes reductions by unit productions (<A> ::= <B>) out of the tables,
+    see Parser::EliminateUnitProductions(). Returns the number of gotos that
+    were changed to skip them. */
+    size_t EliminateUnitProductions(const ProductionList &productions);
   };
 }
 
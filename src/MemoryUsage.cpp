@@ -0,0 +1,40 @@
+#include "MemoryUsage.h"
+#include "Reduction.h"
+
+namespace GoldCPP
+{
+  TreeMemory MeasureTree(const std::shared_ptr<Reduction> &root)
+  {
+    TreeMemory result;
+    if (!root)
+      return result;
+
+    // Iterative, as trees of long lists are deep
+    std::vector<const Reduction*> pending(1, root.get());
+    while (!pending.empty())
+    {
+      const Reduction *node = pending.back();
+      pending.pop_back();
+
+      ++result.Reductions;
+      result.Bytes += sizeof(Reduction) + kSharedBlockBytes + node->Branches.HeapBytes();
+
+      for (size_t i = 0; i < node->Branches.Count(); ++i)
+      {
+        const Token *token = node->Branches[i].get();
+        if (!token)
+          continue;
+
+        size_t text = HeapBytes(token->StringData);
+        ++result.Tokens;
+        result.TextBytes += text;
+        result.Bytes += sizeof(Token) + kSharedBlockBytes + text;
+
+        if (token->ReductionData)
+          pending.push_back(token->ReductionData.get());
+      }
+    }
+
+    return result;
+  }
+}
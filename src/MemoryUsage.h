@@ -0,0 +1,93 @@
+#ifndef GOLDCPP_MEMORYUSAGE_H
+#define GOLDCPP_MEMORYUSAGE_H
+
+#include "String.h"
+#include "Vector.h"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <climits>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  struct Reduction;
+
+  /* Heap memory owned by a container, not counting the container object
+  itself, nor what the allocator adds to each block. */
+  template <typename T, typename A>
+  size_t HeapBytes(const std::vector<T, A> &items)
+  {
+    return items.capacity() * sizeof(T);
+  }
+
+  template <typename A>
+  size_t HeapBytes(const std::vector<bool, A> &bits)
+  {
+    return (bits.capacity() + CHAR_BIT - 1) / CHAR_BIT;
+  }
+
+  template <typename T>
+  size_t HeapBytes(const Vector<T> &items)
+  {
+    return items.Capacity() * sizeof(T);
+  }
+
+  inline size_t HeapBytes(const GPSTR_T &str)
+  {
+    // Short strings are kept inside the string object
+    const char *data = (const char*)str.data();
+    const char *object = (const char*)&str;
+    std::less<const char*> before;
+    if (!before(data, object) && before(data, object + sizeof(str)))
+      return 0;
+
+    return (str.capacity() + 1) * sizeof(GPCHR_T);
+  }
+
+  /* Estimated bookkeeping that std::make_shared() adds to each object. */
+  const size_t kSharedBlockBytes = sizeof(void*) + 2 * sizeof(int);
+
+  /* Bytes used by the tables of a Parser, see Parser::GetTableMemory().
+  Each figure includes the list objects held by Parser and everything they
+  own on the heap. Allocator overhead is not included. */
+  struct TableMemory
+  {
+    size_t Symbols;         // Including their names and display texts
+    size_t Dfa;
+    size_t CharacterSets;
+    size_t Productions;
+    size_t LRStates;
+    size_t Groups;
+    size_t Other;           // Grammar properties, keyword table and derived lookup tables
+
+    TableMemory() :
+      Symbols(0), Dfa(0), CharacterSets(0), Productions(0), LRStates(0), Groups(0), Other(0)
+    {}
+
+    size_t Total() const
+    {
+      return Symbols + Dfa + CharacterSets + Productions + LRStates + Groups + Other;
+    }
+  };
+
+  /* Size of a parse tree, see MeasureTree(). */
+  struct TreeMemory
+  {
+    size_t Reductions;
+    size_t Tokens;          // Terminals and nonterminals
+    size_t TextBytes;       // Heap memory of the token texts
+    size_t Bytes;           // All of it, including TextBytes
+
+    TreeMemory() :
+      Reductions(0), Tokens(0), TextBytes(0), Bytes(0)
+    {}
+  };
+
+  /* Counts the nodes of the tree below 'root', and the memory they use.
+  Subtrees shared with other trees, such as after an incremental parse,
+  are counted in full. */
+  TreeMemory MeasureTree(const std::shared_ptr<Reduction> &root);
+}
+
+#endif // GOLDCPP_MEMORYUSAGE_H
@@ -0,0 +1,106 @@
+#ifndef GOLDCPP_PARSESTATS_H
+#define GOLDCPP_PARSESTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/* Parser counts what it does (see Parser::GetStats()) only if GOLDCPP_STATS
+is defined. It changes the layout of Parser, so it must be defined the same
+way for every file that includes Parser.h. Without it, none of the counting
+is compiled in. */
+#ifdef GOLDCPP_STATS
+  #define GOLDCPP_STAT(statement) statement
+#else
+  #define GOLDCPP_STAT(statement)
+#endif
+
+namespace GoldCPP
+{
+  /* What a Parser did since Open(). Repairs that error recovery only tried
+  out (see Parser::RecoverErrors) are not counted. */
+  struct ParseStats
+  {
+    static const size_t kSymbolTypes = 8;   // Symbol::SymbolType values are below this
+
+    uint64_t Tokens[kSymbolTypes];  // Returned by the lexer by Symbol::SymbolType, including Noise that Parse() drops
+    uint64_t NoiseRuns;             // Skipped without making a token, see Parser::SkipNoiseRuns
+    uint64_t DfaTransitions;
+    uint64_t Characters;            // Consumed by the lexer
+    uint64_t Shifts;
+    uint64_t Reductions;            // Including trimmed ones
+    uint64_t TrimmedReductions;
+    uint64_t ListAppends;           // Reductions added to a flattened list, see Parser::FlattenList()
+    size_t MaxStackDepth;
+    size_t MaxGroupDepth;
+    uint64_t TokenAllocations;      // Token objects made by the parser
+    uint64_t ReductionAllocations;
+    uint64_t LexNanoseconds;        // Spent producing tokens
+    uint64_t ParseNanoseconds;      // Spent in the LALR state machine
+
+    ParseStats()
+    {
+      Clear();
+    }
+
+    void Clear()
+    {
+      for (size_t i = 0; i < kSymbolTypes; ++i)
+        Tokens[i] = 0;
+      NoiseRuns = 0;
+      DfaTransitions = 0;
+      Characters = 0;
+      Shifts = 0;
+      Reductions = 0;
+      TrimmedReductions = 0;
+      ListAppends = 0;
+      MaxStackDepth = 0;
+      MaxGroupDepth = 0;
+      TokenAllocations = 0;
+      ReductionAllocations = 0;
+      LexNanoseconds = 0;
+      ParseNanoseconds = 0;
+    }
+
+    uint64_t TotalTokens() const
+    {
+      uint64_t total = 0;
+      for (size_t i = 0; i < kSymbolTypes; ++i)
+        total += Tokens[i];
+      return total;
+    }
+
+    static void KeepMax(size_t &max, size_t value)
+    {
+      if (value > max)
+        max = value;
+    }
+  };
+
+  /* Adds the time from its construction to its destruction to 'total'. */
+  class StatTimer
+  {
+  private:
+    uint64_t &Total_;
+    std::chrono::steady_clock::time_point Start_;
+
+#ifndef __GNUC__
+    StatTimer(const StatTimer& that){}
+#else
+    StatTimer(const StatTimer& that) = delete;
+#endif
+
+  public:
+
+    explicit StatTimer(uint64_t &total) :
+      Total_(total), Start_(std::chrono::steady_clock::now())
+    {}
+
+    ~StatTimer()
+    {
+      Total_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start_).count();
+    }
+  };
+}
+
+#endif // GOLDCPP_PARSESTATS_H
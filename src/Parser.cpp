@@ -1,27 +1,49 @@
 #include "Parser.h"
 #include "EGT.h"
+#include "ReloadableGrammar.h"
 #include <cassert>
 #include <memory>
+#include <vector>
+#include <algorithm>
 
 //#include "memcheck/mmgr.h"
 
 namespace GoldCPP
 {
-  const GPSTR_T Parser::kVersion_ = GPSTR_C("5.0");
-
-  void GrammarProperties::setProperty(PropertyIndex index, const GPSTR_T &val)
+  namespace
   {
-    _Properties[index] = val;
+    // Owner of a root handed out on Accept, see Parser::PinTables()
+    struct PinnedTree
+    {
+      std::shared_ptr<Reduction> Root;
+      std::shared_ptr<const GrammarTables> Tables;
+    };
   }
 
-  GPSTR_T GrammarProperties::getProperty(PropertyIndex index) const
-  {
-    return _Properties[index];
-  }
+  const GPSTR_T Parser::kVersion_ = GPSTR_C("5.0");
+  const SymbolIdSet Parser::kNoSymbols_;
+  const GPSTR_T Parser::kNoText_;
 
   Parser::Parser() :
-    TrimReductions(false)
+    Tables_(),
+    OwnTables_(),
+    Follow_(NULL),
+    FollowedVersion_(0),
+    Text_(&kNoText_),
+    Profile_(NULL),
+    Checkpoints_(NULL),
+    CheckpointInterval_(0),
+    NextCheckpoint_(0),
+    LexReach_(0),
+    TrimReductions(false),
+    SkipNoiseRuns(false),
+    RecoverErrors(false)
   {
+#ifdef GOLDCPP_TRACE
+    Trace_ = NULL;
+#endif
+    OwnTables_ = std::make_shared<GrammarTables>();
+    Tables_ = OwnTables_;
     Clear();
   }
 
@@ -38,13 +60,51 @@ namespace GoldCPP
   void Parser::SetCurrentReduction(const std::shared_ptr<Reduction> &value)
   {
     if (HaveReduction_)
-        Stack_.top()->ReductionData = value;
+    {
+      if (Stack_.top().use_count() > 1)     // Also on the stack of a saved state
+      {
+        std::shared_ptr<Token> Head = std::make_shared<Token>(*Stack_.top());
+        GOLDCPP_STAT(++Stats_.TokenAllocations);
+        Stack_.pop();
+        Stack_.push(Head);
+      }
+
+      Stack_.top()->ReductionData = value;
+    }
+  }
+
+  void Parser::PinTables()
+  {
+    /* Trees point into the tables they were parsed with. The root handed out
+    on Accept shares the ownership of those tables, so they stay as long as
+    the tree is kept, even after this Parser took other tables. */
+
+    std::shared_ptr<Reduction> root = GetCurrentReduction();
+    if (!root)
+      return;
+
+    std::shared_ptr<PinnedTree> pinned = std::make_shared<PinnedTree>();
+    pinned->Root = root;
+    pinned->Tables = Tables_;
+    SetCurrentReduction(std::shared_ptr<Reduction>(pinned, root.get()));
   }
 
   /* Current line and column being read from the source. */
   Position Parser::GetCurrentPosition() const
   {
-    return CurrentPosition_;
+    return GetPosition(CurrentOffset_);
+  }
+
+  /* Line and column of a character offset in the source. */
+  Position Parser::GetPosition(size_t offset) const
+  {
+    return Source_ ? Source_->GetPosition(offset) : Position();
+  }
+
+  /* The text being parsed, as given to Open(). */
+  const GPSTR_T& Parser::GetSource() const
+  {
+    return *Text_;
   }
 
   /* If the Parse() function returns TokenRead,
@@ -73,6 +133,501 @@ namespace GoldCPP
     InputTokens_.Push(token);
   }
 
+  /* Reads the next token from the input without parsing it. */
+  std::shared_ptr<Token> Parser::ReadToken()
+  {
+    return ProduceToken();
+  }
+
+  /* Records lexer checkpoints about every 'interval' characters. */
+  void Parser::RecordCheckpoints(LexerCheckpointList *checkpoints, size_t interval)
+  {
+    Checkpoints_ = checkpoints;
+    CheckpointInterval_ = interval;
+    NextCheckpoint_ = BufferPos_;
+  }
+
+  /* Continues lexing from a checkpoint. */
+  void Parser::RestoreLexer(const LexerCheckpoint &checkpoint)
+  {
+    BufferPos_ = checkpoint.Offset;
+    TokenCount_ = checkpoint.TokenIndex;
+    NextCheckpoint_ = checkpoint.Offset;
+    LexReach_ = checkpoint.Reach;
+
+    // Open groups hold all text from their start, up to where the next group starts
+    GroupStack_ = TokenStack();
+    for (size_t i = 0; i < checkpoint.Groups.size(); ++i)
+    {
+      size_t begin = checkpoint.Groups[i].second;
+      size_t end = (i + 1 < checkpoint.Groups.size()) ? checkpoint.Groups[i + 1].second : checkpoint.Offset;
+
+      std::shared_ptr<Token> Group = std::make_shared<Token>();
+      GOLDCPP_STAT(++Stats_.TokenAllocations);
+      Group->Parent = checkpoint.Groups[i].first;
+      Group->StringData = Text_->substr(begin, end - begin);
+      Group->Location = Span(begin, end);
+      GroupStack_.push(Group);
+    }
+    GOLDCPP_STAT(ParseStats::KeepMax(Stats_.MaxGroupDepth, GroupStack_.size()));
+  }
+
+  size_t Parser::GetLexReach() const
+  {
+    return LexReach_;
+  }
+
+  void Parser::SaveCheckpoint()
+  {
+    LexerCheckpoint checkpoint;
+    checkpoint.Offset = BufferPos_;
+    checkpoint.TokenIndex = TokenCount_;
+    checkpoint.Reach = LexReach_;
+
+    // Copy the group stack bottom first
+    TokenStack groups = GroupStack_;
+    checkpoint.Groups.resize(groups.size());
+    for (size_t i = groups.size(); i > 0; --i)
+    {
+      checkpoint.Groups[i - 1] = std::make_pair(groups.top()->Parent, groups.top()->Location.Begin);
+      groups.pop();
+    }
+
+    Checkpoints_->push_back(checkpoint);
+    NextCheckpoint_ = BufferPos_ + CheckpointInterval_;
+  }
+
+  /* Saves the state of the parser. */
+  bool Parser::SaveState(ParserState &state) const
+  {
+    if (ReuseMode_ != ReuseMode::Off)
+      return false;
+
+    StoreState(state);
+    return true;
+  }
+
+  /* Continues parsing from a saved state. */
+  void Parser::RestoreState(const ParserState &state)
+  {
+    LoadState(state);
+
+    ReuseMode_ = ReuseMode::Off;
+    Reuse_.Clear();
+  }
+
+  void Parser::StoreState(ParserState &state) const
+  {
+    state.CurrentLALR = CurrentLALR_;
+    state.Stack = Stack_;
+    state.InputTokens = InputTokens_;
+    state.GroupStack = GroupStack_;
+    state.ExpectedSymbols = ExpectedSymbols_;
+    state.HaveReduction = HaveReduction_;
+    state.BufferPos = BufferPos_;
+    state.CurrentOffset = CurrentOffset_;
+    state.TokenCount = TokenCount_;
+
+    state.ErrorCount = Errors_.Count();
+    state.RepairPending = RepairPending_;
+    state.RepairFailed = RepairFailed_;
+    state.RepairInsert = Repair_.Insert;
+    state.RepairPops = Repair_.Pops;
+    state.RepairSkip = Repair_.Skip;
+  }
+
+  void Parser::LoadState(const ParserState &state)
+  {
+    CurrentLALR_ = state.CurrentLALR;
+    Stack_ = state.Stack;
+    InputTokens_ = state.InputTokens;
+    GroupStack_ = state.GroupStack;
+    ExpectedSymbols_ = state.ExpectedSymbols;
+    HaveReduction_ = state.HaveReduction;
+    BufferPos_ = state.BufferPos;
+    CurrentOffset_ = state.CurrentOffset;
+    TokenCount_ = state.TokenCount;
+    NextCheckpoint_ = BufferPos_;
+
+    Errors_.Resize(state.ErrorCount);
+    RepairPending_ = state.RepairPending;
+    RepairFailed_ = state.RepairFailed;
+    Repair_.Insert = state.RepairInsert;
+    Repair_.Pops = state.RepairPops;
+    Repair_.Skip = state.RepairSkip;
+  }
+
+  /* Makes a terminal a point to resume parsing at after an error. */
+  bool Parser::AddSyncSymbol(const GPSTR_T &name)
+  {
+    for (size_t i = 0; i < Tables_->SymbolTable_.Count(); ++i)
+    {
+      const Symbol &sym = Tables_->SymbolTable_[i];
+      if ((sym.Type == Symbol::SymbolType::Content) && (sym.Name == name))
+      {
+        SyncSymbols_.resize(Tables_->SymbolTable_.Count(), false);
+        SyncSymbols_[sym.TableIndex] = true;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool Parser::IsListProduction(const Production &prod)
+  {
+    // <List> ::= <List> followed by a tail without <List>
+    size_t n = prod.Handle.Count();
+    if ((n < 2) || (n > kMaxListTail + 1) || (prod.Handle.GetId(0) != prod.Head->TableIndex))
+      return false;
+
+    for (size_t i = 1; i < n; ++i)
+    {
+      if (prod.Handle.GetId(i) == prod.Head->TableIndex)
+        return false;
+    }
+    return true;
+  }
+
+  bool Parser::FlattenList(const GPSTR_T &name)
+  {
+    bool found = false;
+    for (size_t i = 0; i < Tables_->ProductionTable_.Count(); ++i)
+    {
+      const Production &prod = Tables_->ProductionTable_[i];
+      if ((prod.Head->Name == name) && IsListProduction(prod))
+      {
+        ListProductions_.resize(Tables_->ProductionTable_.Count(), false);
+        ListProductions_[prod.TableIndex] = true;
+        found = true;
+      }
+    }
+
+    return found;
+  }
+
+  size_t Parser::FlattenLists()
+  {
+    /* Lists are told apart from other recursion, such as the operators of
+    an expression grammar, by having a single production that recurses. */
+    std::vector<uint16_t> recursions(Tables_->SymbolTable_.Count(), 0);
+    std::vector<uint16_t> lists(Tables_->SymbolTable_.Count(), 0);
+    for (size_t i = 0; i < Tables_->ProductionTable_.Count(); ++i)
+    {
+      const Production &prod = Tables_->ProductionTable_[i];
+      uint16_t head = prod.Head->TableIndex;
+      if (std::find(prod.Handle.begin(), prod.Handle.end(), head) != prod.Handle.end())
+        ++recursions[head];
+      if (IsListProduction(prod))
+        ++lists[head];
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < Tables_->ProductionTable_.Count(); ++i)
+    {
+      const Production &prod = Tables_->ProductionTable_[i];
+      uint16_t head = prod.Head->TableIndex;
+      if ((recursions[head] == 1) && (lists[head] == 1) && IsListProduction(prod))
+      {
+        ListProductions_.resize(Tables_->ProductionTable_.Count(), false);
+        ListProductions_[prod.TableIndex] = true;
+        ++count;
+      }
+    }
+
+    return count;
+  }
+
+  bool Parser::AppendToList(const Production *Prod, std::shared_ptr<Token> &Head)
+  {
+    /* Adds the tail of a list production (see FlattenList()) to the node of
+    the list below it on the stack, in place of making a new node. Returns
+    false, leaving the stack as it was, if that node was made by another
+    production, or is held by anyone else who would see it change. */
+
+    size_t n = Prod->Handle.Count();
+    std::shared_ptr<Token> tail[kMaxListTail];
+    for (size_t i = n - 1; i > 0; --i)
+    {
+      tail[i - 1] = Stack_.top();
+      Stack_.pop();
+    }
+
+    Head = Stack_.top();
+    Stack_.pop();
+
+    const std::shared_ptr<Reduction> &node = Head->ReductionData;
+    if ((Head.use_count() > 1) || !node || (node.use_count() > 1) || (node->Parent != Prod))
+    {
+      Stack_.push(Head);
+      for (size_t i = 0; i < n - 1; ++i)
+        Stack_.push(tail[i]);
+      Head = NULL;
+      return false;
+    }
+
+    node->Location.End = tail[n - 2]->Location.End;
+    Head->Location = node->Location;
+
+    // Tails reused from a previous tree may shift the branches that follow them, see Reduction::GetShift()
+    ptrdiff_t shift = node->GetShift(node->Branches.Count());
+    for (size_t i = 0; i < n - 1; ++i)
+    {
+      LabelBranch(tail[i], Prod->Handle.GetId(i + 1));
+      if (shift != 0)
+      {
+        // Copy what is still on the stack of a saved state
+        if (tail[i].use_count() > 1)
+        {
+          tail[i] = std::make_shared<Token>(*tail[i]);
+          GOLDCPP_STAT(++Stats_.TokenAllocations);
+        }
+        if (tail[i]->ReductionData && (tail[i]->ReductionData.use_count() > 1))
+        {
+          tail[i]->ReductionData = std::make_shared<Reduction>(*tail[i]->ReductionData);
+          GOLDCPP_STAT(++Stats_.ReductionAllocations);
+        }
+        TreeCursor::Rebase(*tail[i], -shift);
+      }
+      node->Branches.Add(tail[i]);
+    }
+
+    return true;
+  }
+
+  void Parser::LabelBranch(std::shared_ptr<Token> &Branch, uint16_t symbolId)
+  {
+    /* Tables without unit reductions (see EliminateUnitProductions()) leave
+    the innermost symbol of a chain on the stack, where the production
+    expects the outermost one. */
+
+    if (Branch->Parent->TableIndex == symbolId)
+      return;
+
+    // Copy the token if it is still on the stack of a saved state
+    if (Branch.use_count() > 1)
+    {
+      Branch = std::make_shared<Token>(*Branch);
+      GOLDCPP_STAT(++Stats_.TokenAllocations);
+    }
+    Branch->Parent = &Tables_->SymbolTable_[symbolId];
+  }
+
+  const Vector<ParseError>& Parser::GetErrors() const
+  {
+    return Errors_;
+  }
+
+  void Parser::CollectInput(size_t from, size_t count, std::vector<std::shared_ptr<Token>> &out)
+  {
+    /* Puts up to 'count' tokens of the input queue into 'out', starting at
+    queue index 'from' and skipping Noise. More tokens are read as needed.
+    Stops after the End token, and before tokens that cannot be tried out
+    (lexical errors, and subtrees reused from a previous tree). */
+
+    out.clear();
+    for (size_t i = from; out.size() < count; ++i)
+    {
+      if (i == InputTokens_.Count())
+        InputTokens_.Enqueue(NextInputToken());
+
+      const std::shared_ptr<Token> &Read = InputTokens_.Peek(i);
+      Symbol::SymbolType type = Read->GetType();
+      if (type == Symbol::SymbolType::Noise)
+        continue;
+      if ((type == Symbol::SymbolType::Error) || (type == Symbol::SymbolType::Nonterminal))
+        break;
+
+      out.push_back(Read);
+      if (type == Symbol::SymbolType::End)
+        break;
+    }
+  }
+
+  size_t Parser::TryInput(size_t pops, const std::vector<std::shared_ptr<Token>> &input)
+  {
+    /* Pops 'pops' tokens off the stack, then parses 'input' until an error.
+    Returns the number of tokens shifted, or all of them if the input is
+    accepted. The state of the parser is left unchanged, and so are the
+    profile and the counts, as the trial is not really parsed. Neither is
+    it traced. */
+
+    ParserState saved;
+    StoreState(saved);
+    TableProfile *profile = Profile_;
+    Profile_ = NULL;
+    GOLDCPP_STAT(ParseStats stats = Stats_);
+#ifdef GOLDCPP_TRACE
+    TraceRecorder *trace = Trace_;
+    Trace_ = NULL;
+#endif
+
+    for (size_t i = 0; i < pops; ++i)
+      Stack_.pop();
+    CurrentLALR_ = Stack_.top()->State;
+
+    size_t shifted = 0;
+    bool failed = false;
+    while ((shifted < input.size()) && !failed)
+    {
+      switch (ParseLALR(input[shifted]))
+      {
+        case ParseResult::Shift:
+          ++shifted;
+          break;
+        case ParseResult::ReduceNormal:
+        case ParseResult::ReduceEliminated:
+          break;
+        case ParseResult::Accept:
+          shifted = input.size();
+          break;
+        default:
+          failed = true;
+          break;
+      }
+    }
+
+    LoadState(saved);
+    Profile_ = profile;
+    GOLDCPP_STAT(Stats_ = stats);
+#ifdef GOLDCPP_TRACE
+    Trace_ = trace;
+#endif
+    return shifted;
+  }
+
+  void Parser::PlanRepair(ParseError &error)
+  {
+    /* Finds a repair for the syntax error at the top of the input queue. A
+    repair is only taken if the next kCheck tokens (or all up to the end)
+    can be parsed after it. */
+
+    static const size_t kCheck = 3;
+
+    std::vector<std::shared_ptr<Token>> ahead;
+    CollectInput(0, kCheck + 1, ahead);
+    const std::shared_ptr<Token> &Read = ahead[0];
+
+    // === Insert a terminal the current state can go on with
+    std::vector<std::shared_ptr<Token>> trial(ahead.size() + 1);
+    std::copy(ahead.begin(), ahead.end(), trial.begin() + 1);
+
+    // In the order of symbol ids, which does not change with the layout of the tables
+    const SymbolIdSet &expected = Tables_->LRStates_[CurrentLALR_].Expected;
+    for (SymbolIdSet::Iterator it = expected.begin(); it != expected.end(); ++it)
+    {
+      const Symbol *sym = &Tables_->SymbolTable_[*it];
+      if (sym->Type != Symbol::SymbolType::Content)
+        continue;
+
+      trial[0] = std::make_shared<Token>();
+      GOLDCPP_STAT(++Stats_.TokenAllocations);
+      trial[0]->Parent = sym;
+      trial[0]->Location = Span(Read->Location.Begin, Read->Location.Begin);
+      if (TryInput(0, trial) == trial.size())
+      {
+        Repair_.Insert = trial[0];
+        Repair_.Insert->Source = Source_;
+        error.Repair = ErrorRepair::Inserted;
+        error.Inserted = sym;
+        return;
+      }
+    }
+
+    // === Delete the token read
+    if (Read->GetType() != Symbol::SymbolType::End)
+    {
+      trial.assign(ahead.begin() + 1, ahead.end());
+      if (TryInput(0, trial) == trial.size())
+      {
+        Repair_.Skip = 1;
+        error.Repair = ErrorRepair::Deleted;
+        error.Dropped = Read->Location;
+        return;
+      }
+    }
+
+    // === Panic mode: drop input up to a synchronizing terminal, and unwind the
+    // stack to a state that can go on with it, or with the token following it.
+    for (size_t skip = 0; ; ++skip)
+    {
+      if (skip == InputTokens_.Count())
+        InputTokens_.Enqueue(NextInputToken());
+
+      const std::shared_ptr<Token> Sync = InputTokens_.Peek(skip);
+      Symbol::SymbolType type = Sync->GetType();
+      if ((type == Symbol::SymbolType::Noise) || (type == Symbol::SymbolType::Error))
+        continue;
+      if (type == Symbol::SymbolType::Nonterminal)
+        break;          // Subtrees of a previous tree cannot be skipped into
+
+      bool isEnd = (type == Symbol::SymbolType::End);
+      bool isSync = isEnd || SyncSymbols_.empty() ||
+        ((Sync->Parent->TableIndex < SyncSymbols_.size()) && SyncSymbols_[Sync->Parent->TableIndex]);
+
+      if (isSync)
+      {
+        std::vector<std::shared_ptr<Token>> from, after;
+        CollectInput(skip, kCheck, from);
+        if (!isEnd)
+          CollectInput(skip + 1, kCheck, after);
+
+        // Try the fewest pops first. 'after' is tried with 'skip' taken up to the token following Sync.
+        TokenStack stack = Stack_;
+        for (size_t pops = 0; stack.size() > 1; ++pops, stack.pop())
+        {
+          const LRState &popped = Tables_->LRStates_[stack.top()->State];
+          const std::vector<std::shared_ptr<Token>> *tries[2] = { &from, &after };
+          for (size_t t = 0; t < 2; ++t)
+          {
+            const std::vector<std::shared_ptr<Token>> &input = *tries[t];
+            if (input.empty() || !popped.GetActionForSymbol(input[0]->Parent))
+              continue;
+            if ((pops == 0) && (skip == 0) && (t == 0))
+              continue;           // That is where we failed
+
+            if (TryInput(pops, input) == input.size())
+            {
+              size_t drop = skip;
+              if (t == 1)
+              {
+                while (InputTokens_.Peek(drop) != input[0])
+                  ++drop;
+              }
+
+              Repair_.Pops = pops;
+              Repair_.Skip = drop;
+              error.Repair = ErrorRepair::Skipped;
+              error.Dropped = Span(Read->Location.Begin, input[0]->Location.Begin);
+              return;
+            }
+          }
+        }
+      }
+
+      if (isEnd)
+        break;
+    }
+
+    error.Repair = ErrorRepair::None;
+  }
+
+  void Parser::ApplyRepair()
+  {
+    for (size_t i = 0; i < Repair_.Pops; ++i)
+      Stack_.pop();
+    if (Repair_.Pops > 0)
+      CurrentLALR_ = Stack_.top()->State;
+
+    for (size_t i = 0; i < Repair_.Skip; ++i)
+      InputTokens_.Dequeue();
+
+    if (Repair_.Insert)
+      InputTokens_.Push(Repair_.Insert);
+
+    Repair_ = Repair();
+  }
+
   GPSTR_T Parser::LookaheadBuffer(size_t count) const
   {
     /* Return Count characters from the lookahead buffer. DO NOT CONSUME
@@ -82,10 +637,10 @@ namespace GoldCPP
     programming, but not necessary.
     */
 
-    if (count > LookaheadBuffer_.size())
-      count = LookaheadBuffer_.size();
+    if (count > Text_->size() - BufferPos_)
+      count = Text_->size() - BufferPos_;
 
-    return LookaheadBuffer_.substr(0, count);
+    return Text_->substr(BufferPos_, count);
   }
 
   GPCHR_T Parser::Lookahead(size_t charIndex) const
@@ -100,8 +655,8 @@ namespace GoldCPP
     code will understand.
     */
 
-    if (charIndex <= LookaheadBuffer_.size())
-      return LookaheadBuffer_[charIndex - 1];
+    if (charIndex <= Text_->size() - BufferPos_)
+      return (*Text_)[BufferPos_ + charIndex - 1];
     else
       return 0;
   }
@@ -113,72 +668,173 @@ namespace GoldCPP
   }
 
   /* Returns a list of Symbols recognized by the grammar. */
-  SymbolList Parser::GetSymbolTable() const
+  const SymbolList& Parser::GetSymbolTable() const
   {
-    return SymbolTable_;
+    return Tables_->SymbolTable_;
   }
 
   /* Returns a list of Productions recognized by the grammar. */
-  ProductionList Parser::GetProductionTable() const
+  const ProductionList& Parser::GetProductionTable() const
+  {
+    return Tables_->ProductionTable_;
+  }
+
+  size_t Parser::GetSymbolCount() const
+  {
+    return Tables_->SymbolTable_.Count();
+  }
+
+  const Symbol& Parser::GetSymbol(uint32_t id) const
+  {
+    return Tables_->SymbolTable_[id];
+  }
+
+  size_t Parser::GetProductionCount() const
+  {
+    return Tables_->ProductionTable_.Count();
+  }
+
+  const Production& Parser::GetProduction(uint16_t id) const
   {
-    return ProductionTable_;
+    return Tables_->ProductionTable_[id];
   }
 
   /* If the Parse() method returns a SyntaxError, this method will contain a list of
   the symbols the grammar expected to see. */
   SymbolList Parser::GetExpectedSymbols() const
   {
-    return ExpectedSymbols_;
+    SymbolList result;
+    const SymbolIdSet &ids = GetExpectedSymbolIds();
+    for (SymbolIdSet::Iterator it = ids.begin(); it != ids.end(); ++it)
+      result.Add(Tables_->SymbolTable_[*it]);
+
+    return result;
+  }
+
+  const SymbolIdSet& Parser::GetExpectedSymbolIds() const
+  {
+    return ExpectedSymbols_ ? *ExpectedSymbols_ : kNoSymbols_;
   }
 
   /* Returns true if parse tables were loaded. */
   bool Parser::TablesLoaded() const
   {
-    return TablesLoaded_;
+    return Tables_->Loaded();
   }
 
   /* Specifies the text to be parsed */
   bool Parser::Open(const GPSTR_T &source)
   {
+    return Open(std::make_shared<SourceText>(source));
+  }
+
+  /* Specifies the text to be parsed, shared with the tokens read */
+  bool Parser::Open(const std::shared_ptr<SourceText> &source)
+  {
+    if (Follow_ && (Follow_->GetVersion() != FollowedVersion_))
+      FollowTables();
+
     Restart();
-    LookaheadBuffer_ = source;
+    Source_ = source;
+    Text_ = &source->GetText();
 
     // Create stack top item. Only needs state
     std::shared_ptr<Token> Start = std::make_shared<Token>();
-    Start->State = LRStates_.InitialState;
+    GOLDCPP_STAT(++Stats_.TokenAllocations);
+    Start->State = Tables_->LRStates_.InitialState;
     Stack_.push(Start);
     return true;
   }
 
+  /* Specifies the text to be parsed, reusing a previous tree */
+  bool Parser::Open(const GPSTR_T &source, const std::shared_ptr<Reduction> &previousTree, const TextEdit &edit)
+  {
+    const GrammarTables *before = Tables_.get();
+    if (Follow_ && (Follow_->GetVersion() != FollowedVersion_))
+      FollowTables();
+
+    // A tree of other tables has other symbols and states
+    if (!previousTree || (Tables_.get() != before))
+      return Open(source);
+
+    // The tokens taken over from the previous tree refer to its text, which becomes the new one
+    std::shared_ptr<SourceText> text;
+    for (size_t i = 0; !text && (i < previousTree->Branches.Count()); ++i)
+      text = previousTree->Branches[i]->Source;
+
+    if (text)
+    {
+      text->Assign(source);
+      Open(text);
+    }
+    else
+    {
+      Open(source);
+    }
+
+    /* Replace the stack with what it was right before the first token we need
+    to lex again, and continue lexing from there. */
+    if (Reuse_.Reset(previousTree, Tables_->LRStates_, edit))
+    {
+      Reuse_.PushLeftContext(Stack_);
+      CurrentLALR_ = Stack_.top()->State;
+      BufferPos_ = Reuse_.CurrentLocation().Begin;
+    }
+
+    ReuseMode_ = ReuseMode::Lexing;
+    return true;
+  }
+
   /* Restarts the parser. Loaded tables are retained. */
   void Parser::Restart()
   {
-    LookaheadBuffer_ = GPSTR_C("");
-    CurrentLALR_ = LRStates_.InitialState;
+    Source_ = NULL;
+    Text_ = &kNoText_;
+    BufferPos_ = 0;
+    CurrentLALR_ = Tables_->LRStates_.InitialState;
     Stack_ = TokenStack();
-    ExpectedSymbols_.Clear();
+    ExpectedSymbols_ = NULL;
     HaveReduction_ = false;
     InputTokens_.Clear();
 
     // Lexer
-    SysPosition_ = Position();
-    CurrentPosition_ = Position();
+    CurrentOffset_ = 0;
 
     // V4
     GroupStack_ = TokenStack();
+
+    ReuseMode_ = ReuseMode::Off;
+    Reuse_.Clear();
+
+    TokenCount_ = 0;
+    NextCheckpoint_ = 0;
+    LexReach_ = 0;
+
+    Errors_.Clear();
+    Repair_ = Repair();
+    RepairPending_ = false;
+    RepairFailed_ = false;
+
+    GOLDCPP_STAT(Stats_.Clear());
   }
 
   void Parser::Clear()
   {
     Restart();
 
-    SymbolTable_.Clear();
-    DFA_.Clear();
-    CharSetTable_.Clear();
-    ProductionTable_.Clear();
-    LRStates_.Clear();
-    TablesLoaded_ = false;
-    GroupTable_.Clear();
+    // Tables of other Parsers are left as they are
+    if (OwnTables_)
+      OwnTables_->Clear();
+    else
+    {
+      OwnTables_ = std::make_shared<GrammarTables>();
+      Tables_ = OwnTables_;
+    }
+
+    Follow_ = NULL;
+    SyncSymbols_.clear();
+    ListProductions_.clear();
+    Profile_ = NULL;
     Grammar = GrammarProperties();
   }
 
@@ -187,167 +843,180 @@ namespace GoldCPP
   {
     Clear();
 
-    EgtReader EGT(binstream, len);
+    if (!OwnTables_->Load(binstream, len))
+      return false;
+
+    Grammar = Tables_->GetGrammar();
+    Restart();
+    return true;
+  }
+
+  const EgtError& Parser::GetLoadError() const
+  {
+    return Tables_->GetLoadError();
+  }
+
+  bool Parser::UseTables(const std::shared_ptr<const GrammarTables> &tables)
+  {
+    Clear();
+    if (!tables || !tables->Loaded())
+      return false;
+
+    Tables_ = tables;
+    OwnTables_ = NULL;
+
+    Grammar = Tables_->GetGrammar();
+    Restart();
+    return true;
+  }
 
-    bool egtSuccess;
-    bool Success = true;
-    while(!EGT.EofReached() && Success)
+  std::shared_ptr<const GrammarTables> Parser::ShareTables()
+  {
+    OwnTables_ = NULL;
+    return Tables_;
+  }
+
+  bool Parser::Follow(const ReloadableGrammar *grammar)
+  {
+    Follow_ = grammar;
+    if (!Follow_)
+      return Tables_->Loaded();
+
+    bool loaded = FollowTables();
+    Restart();
+    return loaded;
+  }
+
+  /* Switches to the current tables of Follow_, unless they are in use already. */
+  bool Parser::FollowTables()
+  {
+    // Read before the tables, so tables newer than the version are taken again at worst
+    FollowedVersion_ = Follow_->GetVersion();
+    std::shared_ptr<const GrammarTables> tables = Follow_->Get();
+    if (!tables)
+      return false;
+    if (tables == Tables_)
+      return true;
+
+    std::vector<GPSTR_T> syncNames;
+    for (size_t i = 0; i < SyncSymbols_.size(); ++i)
     {
-      EGT.GetNextRecord();
-      EgtReader::EgtRecord RecType = (EgtReader::EgtRecord)EGT.RetrieveByte(&egtSuccess);
-      assert(egtSuccess);
+      if (SyncSymbols_[i])
+        syncNames.push_back(Tables_->SymbolTable_[i].Name);
+    }
 
-      switch(RecType)
-      {
-      case EgtReader::Property:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        GPSTR_T name = EGT.RetrieveString(&egtSuccess); assert(egtSuccess);
-        Grammar.setProperty((GrammarProperties::PropertyIndex)index, name);
-        break;
-        }
-      case EgtReader::TableCounts:
-        {
-        SymbolTable_ = SymbolList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        CharSetTable_ = CharacterSetList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        ProductionTable_ = ProductionList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        DFA_ = FaStateList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        LRStates_ = LRStateList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        GroupTable_ = GroupList(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
-        break;
-        }
-      case EgtReader::InitialStates:
-        {
-        DFA_.InitialState = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        LRStates_.InitialState = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        break;
-        }
-      case EgtReader::Symbol:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        GPSTR_T name = EGT.RetrieveString(&egtSuccess); assert(egtSuccess);
-        Symbol::SymbolType type = (Symbol::SymbolType)EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        SymbolTable_[index] = Symbol(name, type, index);
-        break;
-        }
-      case EgtReader::Group:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
+    std::vector<GPSTR_T> listNames;
+    for (size_t i = 0; i < ListProductions_.size(); ++i)
+    {
+      const GPSTR_T &name = Tables_->ProductionTable_[i].Head->Name;
+      if (ListProductions_[i] && (std::find(listNames.begin(), listNames.end(), name) == listNames.end()))
+        listNames.push_back(name);
+    }
 
-        GroupTable_[index] = Group();
-        Group *G = &(GroupTable_[index]);
+    // Only our reference to the old tables goes, other Parsers may still use them
+    Tables_ = tables;
+    OwnTables_ = NULL;
+    Grammar = Tables_->GetGrammar();
 
-        G->Name = EGT.RetrieveString(&egtSuccess); assert(egtSuccess);
-        G->Container = &(SymbolTable_[EGT.RetrieveInt16(&egtSuccess)]); assert(egtSuccess);
-        G->Start = &(SymbolTable_[EGT.RetrieveInt16(&egtSuccess)]); assert(egtSuccess);
-        G->End = &(SymbolTable_[EGT.RetrieveInt16(&egtSuccess)]); assert(egtSuccess);
+    SyncSymbols_.clear();
+    for (size_t i = 0; i < syncNames.size(); ++i)
+      AddSyncSymbol(syncNames[i]);
 
-        G->Advance = (Group::AdvanceMode)EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        G->Ending = (Group::EndingMode)EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveEntry();  // Reserved
+    ListProductions_.clear();
+    for (size_t i = 0; i < listNames.size(); ++i)
+      FlattenList(listNames[i]);
 
-        uint16_t count = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        G->Nesting.Reserve(count);
-        for (uint16_t i = 0; i < count; ++i)
-          G->Nesting.Add(EGT.RetrieveInt16(&egtSuccess)); assert(egtSuccess);
+    // Counts of the old tables do not fit the new ones
+    if (Profile_)
+      RecordProfile(Profile_);
+    return true;
+  }
 
-        // Link back
-        G->Container->GoldGroup = G;
-        G->Start->GoldGroup = G;
-        G->End->GoldGroup = G;
+  void Parser::OptimizeDFA()
+  {
+    if (!OwnTables_)
+      return;
 
-        break;
-        }
-      case EgtReader::CharRanges:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess); // codepage
-        uint16_t total = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveEntry();  // Reserved
+    OwnTables_->OptimizeDFA();
 
-        CharSetTable_[index] = CharacterSet();
-        CharacterSet *charSet = &(CharSetTable_[index]);
-        charSet->Reserve(total);
+    if (Profile_)
+      Profile_->Reset(Tables_->DFA_, Tables_->LRStates_);
+  }
 
-        uint16_t rangesFound = 0;
-        while(!EGT.RecordComplete())
-        {
-          ++rangesFound;
-          uint32_t rangeStart = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          uint32_t rangeEnd = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          charSet->Add(CharacterRange(rangeStart, rangeEnd));
-        }
-        assert(rangesFound == total);
-        break;
-        }
-      case EgtReader::Production:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        uint16_t headIndex = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveEntry();  // Reserved
+  DfaStats Parser::GetDfaStats() const
+  {
+    return Tables_->GetDfaStats();
+  }
 
-        ProductionTable_[index] = Production(&(SymbolTable_[headIndex]), index);
+  TableMemory Parser::GetTableMemory() const
+  {
+    TableMemory result = Tables_->GetMemory();
+    result.Other += sizeof(SyncSymbols_) + HeapBytes(SyncSymbols_);
+    result.Other += sizeof(ListProductions_) + HeapBytes(ListProductions_);
+    return result;
+  }
 
-        SymbolList &symList = ProductionTable_[index].Handle;
-        while(!EGT.RecordComplete())
-        {
-          uint16_t symIndex = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          symList.Add(SymbolTable_[symIndex]);
-        }
-        break;
-        }
-      case EgtReader::DFAState:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        bool accept = EGT.RetrieveBoolean(&egtSuccess); assert(egtSuccess);
-        uint16_t acceptIndex = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveEntry();  // Reserved
+  size_t Parser::HashKeywords()
+  {
+    if (!OwnTables_)
+      return Tables_->Keywords_.Count();
 
-        if (accept)
-          DFA_[index] = FaState(&(SymbolTable_[acceptIndex]));
-        else
-          DFA_[index] = FaState();
+    size_t before = Tables_->Keywords_.Count();
+    size_t count = OwnTables_->HashKeywords();
 
-        FaEdgeList &edgeList = DFA_[index].Edges;
-        while(!EGT.RecordComplete())
-        {
-          uint16_t setIndex = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          uint16_t target = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          EGT.RetrieveEntry();  // Reserved
-          edgeList.Add(FaEdge(&(CharSetTable_[setIndex]), target));
-        }
-        break;
-        }
-      case EgtReader::LRState:
-        {
-        uint16_t index = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-        EGT.RetrieveEntry();  // Reserved
+    if (Profile_ && (count != before))
+      Profile_->Reset(Tables_->DFA_, Tables_->LRStates_);
+    return count;
+  }
 
-        LRStates_[index] = LRState();
+  void Parser::RecordProfile(TableProfile *profile)
+  {
+    Profile_ = profile;
+    if (Profile_ && (Profile_->Fingerprint != TableProfile::GetFingerprint(Tables_->DFA_, Tables_->LRStates_)))
+      Profile_->Reset(Tables_->DFA_, Tables_->LRStates_);
+  }
 
-        Vector<LRAction> &actionList = LRStates_[index].Actions;
-        while(!EGT.RecordComplete())
-        {
-          uint16_t symIndex = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          uint16_t action = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          uint16_t target = EGT.RetrieveInt16(&egtSuccess); assert(egtSuccess);
-          EGT.RetrieveEntry();  // Reserved
-          actionList.Add(LRAction(&(SymbolTable_[symIndex]), (LRActionType)action, target));
-        }
-        break;
-        }
-      default:
-        {
-        Success = false;
-        break;
-        }
-      } // switch
-    } // loop
+  bool Parser::ApplyProfile(const TableProfile &profile)
+  {
+    if (!OwnTables_ || !OwnTables_->ApplyProfile(profile))
+      return false;
 
-    TablesLoaded_ = Success;
-    return Success;
+    if (Profile_)
+      Profile_->Reset(Tables_->DFA_, Tables_->LRStates_);
+    return true;
+  }
 
-  } // method
+  size_t Parser::EliminateUnitProductions()
+  {
+    if (!OwnTables_)
+      return 0;
+
+    size_t count = OwnTables_->EliminateUnitProductions();
+
+    if (Profile_ && (count > 0))
+      Profile_->Reset(Tables_->DFA_, Tables_->LRStates_);
+    return count;
+  }
+
+#ifdef GOLDCPP_STATS
+  const ParseStats& Parser::GetStats() const
+  {
+    return Stats_;
+  }
+#endif
+
+#ifdef GOLDCPP_TRACE
+  void Parser::SetTraceRecorder(TraceRecorder *recorder)
+  {
+    Trace_ = recorder;
+  }
+#endif
+
+  void Parser::CountAction(uint16_t state, const LRAction *action)
+  {
+    ++Profile_->LRStates[state];
+    ++Profile_->LRActions[state][(size_t)(action - &Tables_->LRStates_[state].Actions[0])];
+  }
 
   ParseResult Parser::ParseLALR(const std::shared_ptr<Token> &NextToken)
   {
@@ -359,9 +1028,13 @@ namespace GoldCPP
     If an action is performed that requires controlt to be returned to the user, the function returns true.
     The Message parameter is then set to the type of action. */
 
+    GOLDCPP_STAT(StatTimer timer(Stats_.ParseNanoseconds));
+
     ParseResult Result;
     std::shared_ptr<Token> Head;
-    const LRAction* ParseAction = LRStates_[CurrentLALR_].GetActionForSymbol(NextToken->Parent);
+    const LRAction* ParseAction = Tables_->LRStates_[CurrentLALR_].GetActionForSymbol(NextToken->Parent);
+    if (Profile_ && ParseAction)
+      CountAction(CurrentLALR_, ParseAction);
 
     if (ParseAction)    // Work - shift or reduce
     {
@@ -374,16 +1047,29 @@ namespace GoldCPP
           HaveReduction_ = true;
           Result = ParseResult::Accept;
           break;
+        case LRActionType::Goto:    // Only for subtrees reused from a previous tree
         case LRActionType::Shift:
           CurrentLALR_ = ParseAction->Value;
           NextToken->State = CurrentLALR_;
           Stack_.push(NextToken);
+          GOLDCPP_TRACE_EVENT(Shift, NextToken->Parent->TableIndex, NextToken->Location.Begin);
+          GOLDCPP_STAT(++Stats_.Shifts);
+          GOLDCPP_STAT(ParseStats::KeepMax(Stats_.MaxStackDepth, Stack_.size()));
           Result = ParseResult::Shift;
           break;
         case LRActionType::Reduce:
           {
           // Produce a reduction - remove as many tokens as members in the rule & push a nonterminal token
-          Production *Prod = &(ProductionTable_[ParseAction->Value]);
+          const Production *Prod = &(Tables_->ProductionTable_[ParseAction->Value]);
+
+          /* Tables that passed loading can still disagree with each other, and reduce more
+          tokens than were shifted. The bottom of the stack holds the initial state. */
+          if (Stack_.size() <= Prod->Handle.Count())
+          {
+            Result = ParseResult::InternalError;
+            break;
+          }
+          GOLDCPP_STAT(++Stats_.Reductions);
 
           // Create Reduction
           if (TrimReductions && Prod->ContainsOneNonTerminal())
@@ -399,21 +1085,47 @@ namespace GoldCPP
             Head = Stack_.top();
             Stack_.pop();
 
+            // Copy the token if it is still on the stack of a saved state
+            if (Head.use_count() > 1)
+            {
+              Head = std::make_shared<Token>(*Head);
+              GOLDCPP_STAT(++Stats_.TokenAllocations);
+            }
+            GOLDCPP_STAT(++Stats_.TrimmedReductions);
+
             Head->Parent = Prod->Head;
             Result = ParseResult::ReduceEliminated;
           }
+          else if ((Prod->TableIndex < ListProductions_.size()) && ListProductions_[Prod->TableIndex] && AppendToList(Prod, Head))
+          {
+            HaveReduction_ = true;
+            GOLDCPP_STAT(++Stats_.ListAppends);
+            Result = ParseResult::ReduceNormal;
+          }
           else // Build a Reduction
           {
             HaveReduction_ = true;
-            std::shared_ptr<Reduction> NewReduction = std::make_shared<Reduction>(Prod->Handle.Count());
+            size_t n = Prod->Handle.Count();
+            std::shared_ptr<Reduction> NewReduction = std::make_shared<Reduction>(n);
+            GOLDCPP_STAT(++Stats_.ReductionAllocations);
             NewReduction->Parent = Prod;
-            for (size_t i = Prod->Handle.Count()-1; i < Prod->Handle.Count(); --i)
+            for (size_t i = n-1; i < n; --i)
             {
               NewReduction->Branches[i] = Stack_.top();
               Stack_.pop();
+              LabelBranch(NewReduction->Branches[i], Prod->Handle.GetId(i));
             }
 
+            // An empty production covers no text, right where the next token starts
+            if (n > 0)
+              NewReduction->Location = Span(NewReduction->Branches[0]->Location.Begin, NewReduction->Branches[n-1]->Location.End);
+            else
+              NewReduction->Location = Span(NextToken->Location.Begin, NextToken->Location.Begin);
+
             Head = std::make_shared<Token>(Prod->Head, NewReduction);
+            GOLDCPP_STAT(++Stats_.TokenAllocations);
+            Head->Source = Source_;
+            Head->Location = NewReduction->Location;
             Result = ParseResult::ReduceNormal;
           }
 
@@ -421,12 +1133,16 @@ namespace GoldCPP
           uint16_t index = Stack_.top()->State;
 
           // ========= If n is -1 here, then we have an Internal Table Error!!!!
-          const LRAction *action = LRStates_[index].GetActionForSymbol(Prod->Head);
+          const LRAction *action = Tables_->LRStates_[index].GetActionForSymbol(Prod->Head);
+          if (Profile_ && action)
+            CountAction(index, action);
           if (action)
           {
             CurrentLALR_ = action->Value;
             Head->State = CurrentLALR_;
             Stack_.push(Head);
+            GOLDCPP_TRACE_EVENT(Reduce, Prod->TableIndex, Head->Location.Begin);
+            GOLDCPP_STAT(ParseStats::KeepMax(Stats_.MaxStackDepth, Stack_.size()));
           }
           else
           {
@@ -441,22 +1157,8 @@ namespace GoldCPP
     }
     else
     {
-      // === Syntax Error! Fill Expected Tokens
-      ExpectedSymbols_.Clear();
-      for (size_t i = 0; i < LRStates_[CurrentLALR_].Actions.Count(); ++i)
-      {
-        LRAction *Action = &(LRStates_[CurrentLALR_].Actions[i]);
-        switch (Action->Sym->Type)
-        {
-          case Symbol::SymbolType::Content:
-          case Symbol::SymbolType::End:
-          case Symbol::SymbolType::GroupStart:
-          case Symbol::SymbolType::GroupEnd:
-            ExpectedSymbols_.Add(*(Action->Sym));
-          default:
-            break;
-        }
-      }
+      // === Syntax Error! The expected tokens are known from the tables
+      ExpectedSymbols_ = &Tables_->LRStates_[CurrentLALR_].Expected;
       Result = ParseResult::SyntaxError;
     }
 
@@ -474,15 +1176,19 @@ namespace GoldCPP
     // Match DFA token
     // ===================================================
 
+    const FaStateList &DFA = Tables_->DFA_;
     bool Found = false;
     bool Done = false;
-    uint16_t CurrentDFA = DFA_.InitialState;
+    uint16_t CurrentDFA = DFA.InitialState;
     size_t CurrentPosition = 1;               // Next byte in the input Stream
     int LastAcceptState = -1;                 // We have not yet accepted a character string
     size_t LastAcceptPosition;                // This used to be initilaized to -1 (and be int) in .NET, but that seems totally useless
     uint16_t Target = (uint16_t)-1;
     std::shared_ptr<Token> Result = std::make_shared<Token>();
+    GOLDCPP_STAT(++Stats_.TokenAllocations);
 
+    if (Profile_)
+      ++Profile_->DfaStates[CurrentDFA];
 
     GPCHR_T ch = Lookahead(1);
     if  ((ch !=0) )
@@ -500,15 +1206,21 @@ namespace GoldCPP
         {
           size_t n = 0;
           Found = false;
-          while (n < DFA_[CurrentDFA].Edges.Count() && !Found)
+          while (n < DFA[CurrentDFA].Edges.Count() && !Found)
           {
-              FaEdge &Edge = DFA_[CurrentDFA].Edges[n];
+              const FaEdge &Edge = DFA[CurrentDFA].Edges[n];
 
               // ==== Look for character in the Character Set Table
               if (Edge.Characters->Contains(ch))
               {
                 Found = true;
                 Target = Edge.Target;
+
+                if (Profile_)
+                {
+                  ++Profile_->DfaEdges[CurrentDFA][n];
+                  ++Profile_->DfaStates[Target];
+                }
               }
               ++n;
           }
@@ -521,12 +1233,14 @@ namespace GoldCPP
 
         if (Found)
         {
+          GOLDCPP_STAT(++Stats_.DfaTransitions);
+
           /* This code checks whether the target state accepts a token.
           If so, it sets the appropiate variables so when the
           algorithm in done, it can return the proper token and
           number of characters. */
 
-          if (DFA_[Target].Accept)      // This check is very important!
+          if (DFA[Target].Accept)      // This check is very important!
           {
             LastAcceptState = Target;
             LastAcceptPosition = CurrentPosition;
@@ -540,14 +1254,14 @@ namespace GoldCPP
             Done = true;
             if (LastAcceptState == -1)     // Lexer cannot recognize symbol
             {
-              Result->Parent = SymbolTable_.GetFirstOfType(Symbol::SymbolType::Error);
+              Result->Parent = Tables_->SymbolTable_.GetFirstOfType(Symbol::SymbolType::Error);
               Result->StringData = LookaheadBuffer(1);
             }
             else                           // Create Token, read characters
             {
               assert(LastAcceptState >= 0);
-              Result->Parent = DFA_[(size_t)LastAcceptState].Accept;
               Result->StringData = LookaheadBuffer(LastAcceptPosition);   // Data contains the total number of accept characters
+              Result->Parent = Tables_->Keywords_.Classify(DFA[(size_t)LastAcceptState].Accept, Result->StringData);
             }
         }
       } // while
@@ -556,15 +1270,19 @@ namespace GoldCPP
     {
         // End of file reached, create End Token
         Result->StringData = GPSTR_C("");
-        Result->Parent = SymbolTable_.GetFirstOfType(Symbol::SymbolType::End);
+        Result->Parent = Tables_->SymbolTable_.GetFirstOfType(Symbol::SymbolType::End);
     }
 
+    // The DFA stopped at the character at CurrentPosition, or at the end of the text
+    if (BufferPos_ + CurrentPosition > LexReach_)
+      LexReach_ = BufferPos_ + CurrentPosition;
+
     // ===================================================
     // Set the new token's position information
     // ===================================================
-    // Notice, this is a copy, not a linking of an instance. We don't want the user
-    // to be able to alter the main value indirectly.
-    Result->Pos = SysPosition_;
+    // Line and column are only computed from this if someone asks for them.
+    // Group tokens are extended by ProduceToken() as the group grows.
+    Result->Location = Span(BufferPos_, BufferPos_ + Result->StringData.size());
 
     return Result;
   } //method
@@ -573,31 +1291,62 @@ namespace GoldCPP
   {
     // Consume/Remove the characters from the front of the buffer.
 
-    if (charCount <= LookaheadBuffer_.size())
+    if (charCount <= Text_->size() - BufferPos_)
     {
-      /* Count Carriage Returns and increment the internal column and line
-      numbers. This is done for the Developer and is not necessary for the
-      DFA algorithm. */
-      for (size_t i = 0; i < charCount; ++i)
+      /* Keep the text in place, erasing from the front would copy the rest of the input.
+      Lines and columns are not counted here, GetPosition() derives them
+      from offsets when needed. */
+      BufferPos_ += charCount;
+      GOLDCPP_STAT(Stats_.Characters += charCount);
+    } // if
+  } // method
+
+  void Parser::ScanGroupBody()
+  {
+    // Append everything up to the next character that could end the group or start a nested one
+
+    const std::shared_ptr<Token> &Top = GroupStack_.top();
+    const GrammarTables::GroupScan &scan = Tables_->GroupScans_[Top->GetGroup()->TableIndex];
+    if (!scan.Enabled)
+      return;
+
+    size_t runLength = scan.Stops.FindFirst(Text_->data() + BufferPos_, Text_->size() - BufferPos_);
+    if (runLength > 0)
+    {
+      Top->StringData.append(*Text_, BufferPos_, runLength);
+      ConsumeBuffer(runLength);
+    }
+  }
+
+  void Parser::SkipNoise()
+  {
+    // Consume runs found by FindNoiseRuns() until the next character starts something else.
+
+    const Vector<GrammarTables::NoiseRun> &NoiseRuns = Tables_->NoiseRuns_;
+    size_t numRuns = NoiseRuns.Count();
+    bool Skipped = true;
+    while (Skipped)
+    {
+      Skipped = false;
+
+      GPCHR_T ch = Lookahead(1);
+      if (ch == 0)
+        break;
+
+      for (size_t i = 0; i < numRuns; ++i)
       {
-        switch (LookaheadBuffer_[i])
+        if (NoiseRuns[i].First->Contains(ch))
         {
-        case 10: // LF
-          SysPosition_.Line += 1;
-          SysPosition_.Column = 0;
-          break;
-        case 13: // CR
-          // Ignore, LF is used to increment line to be UNIX friendly
-          break;
-        default:
-          SysPosition_.Column += 1;
+          size_t first = BufferPos_ + 1;
+          size_t runLength = 1 + NoiseRuns[i].Rest.SpanLength(Text_->data() + first, Text_->size() - first);
+          ConsumeBuffer(runLength);
+          GOLDCPP_STAT(++Stats_.NoiseRuns);
+          Skipped = true;
           break;
         }
       }
-
-      LookaheadBuffer_ = LookaheadBuffer_.erase(0, charCount);
-    } // if
-  } // method
+    }
+  }
 
   std::shared_ptr<Token> Parser::ProduceToken()
   {
@@ -609,12 +1358,22 @@ namespace GoldCPP
     level counter. Also, text is appended to the token on the top of the
     stack. This allows the group text to returned in one chunk. */
 
+    GOLDCPP_STAT(StatTimer timer(Stats_.LexNanoseconds));
+
     std::shared_ptr<Token> Result;
     bool Done = false;
     bool NestGroup = false;
 
     while (!Done)
     {
+      if (Checkpoints_ && (BufferPos_ >= NextCheckpoint_))
+        SaveCheckpoint();
+
+      if (!GroupStack_.empty())
+        ScanGroupBody();
+      else if (SkipNoiseRuns)
+        SkipNoise();
+
       std::shared_ptr<Token> Read = LookaheadDFA();
 
       /* The logic - to determine if a group should be nested - requires that the top of the stack
@@ -640,6 +1399,8 @@ namespace GoldCPP
       {
         ConsumeBuffer(Read->StringData.size());
         GroupStack_.push(Read);
+        GOLDCPP_TRACE_EVENT(GroupPush, Read->Parent->TableIndex, Read->Location.Begin);
+        GOLDCPP_STAT(ParseStats::KeepMax(Stats_.MaxGroupDepth, GroupStack_.size()));
       }
       else if (GroupStack_.empty())
       {
@@ -653,6 +1414,7 @@ namespace GoldCPP
         //End the current group
         std::shared_ptr<Token> Pop = GroupStack_.top();
         GroupStack_.pop();
+        GOLDCPP_TRACE_EVENT(GroupPop, Pop->Parent->TableIndex, BufferPos_);
 
         // === Ending logic
         if (Pop->GetGroup()->Ending == Group::EndingMode::Closed)
@@ -664,6 +1426,7 @@ namespace GoldCPP
         if (GroupStack_.empty())            // We are out of the group. Return pop'd token (which contains all the group text)
         {
           Pop->Parent = Pop->GetGroup()->Container;  // Change symbol to parent
+          Pop->Location.End = BufferPos_;
           Result = Pop;
           Done = true;
         }
@@ -697,9 +1460,120 @@ namespace GoldCPP
       } // if
     } // while
 
+    Result->Source = Source_;
+    ++TokenCount_;
+    GOLDCPP_TRACE_EVENT(Token, Result->Parent->TableIndex, Result->Location.Begin);
+    GOLDCPP_STAT(++Stats_.Tokens[Result->GetType() % ParseStats::kSymbolTypes]);
     return Result;
   }
 
+  std::shared_ptr<Token> Parser::NextInputToken()
+  {
+    /* Normally all input comes from the lexer. After Open() with a previous
+    tree, we only lex until the tokens line up with the tokens of the previous
+    tree behind the edit. From there on, the previous tree is the input. */
+
+    if (ReuseMode_ == ReuseMode::Reusing)
+    {
+      std::shared_ptr<Token> Read = TakeReusedInput();
+      if (Read)
+        return Read;
+
+      ReuseMode_ = ReuseMode::Off;    // Lex the rest (noise and EOF)
+    }
+
+    std::shared_ptr<Token> Read = ProduceToken();
+
+    if ((ReuseMode_ == ReuseMode::Lexing) && GroupStack_.empty())
+    {
+      if (Reuse_.Sync(*Read))
+      {
+        ReuseMode_ = ReuseMode::Reusing;
+        BufferPos_ = Read->Location.Begin;
+        return NextInputToken();
+      }
+      else if (!Reuse_.Current())
+      {
+        ReuseMode_ = ReuseMode::Off;  // Nothing left to reuse
+      }
+    }
+
+    return Read;
+  }
+
+  std::shared_ptr<Token> Parser::TakeReusedInput()
+  {
+    // Terminals are used right away. Subtrees stay current until ParseLALR used them or they are broken up.
+    std::shared_ptr<Token> Read = Reuse_.Take();
+    if (Read)
+    {
+      if (Read->GetType() != Symbol::SymbolType::Nonterminal)
+        Reuse_.Advance();
+
+      BufferPos_ = Read->Location.End;
+    }
+
+    return Read;
+  }
+
+  std::shared_ptr<Token> Parser::ReusedLookahead(const std::shared_ptr<Token> &Subtree)
+  {
+    /* A subtree from the previous tree can be pushed as a whole if the parser
+    is in the same state as when the subtree was first parsed, because then
+    its terminals and the one following it would be parsed the same way again.
+    In another state, the parser may still need to reduce what is on the stack
+    with the subtree's first terminal as lookahead, which may lead to the right
+    state. Otherwise the subtree has to be broken up, for which NULL is returned. */
+
+    if (Reuse_.PreState() == CurrentLALR_)
+      return Subtree;
+
+    std::shared_ptr<Token> First = TreeCursor::FirstTerminal(Subtree);
+    if (!First)
+      return NULL;
+
+    const LRAction *Action = Tables_->LRStates_[CurrentLALR_].GetActionForSymbol(First->Parent);
+    if (!Action || (Action->Type != LRActionType::Reduce))
+      return NULL;
+
+    // Only the subtree was moved to the edited text, see TreeCursor::Take()
+    std::shared_ptr<Token> Lookahead = std::make_shared<Token>(*First);
+    GOLDCPP_STAT(++Stats_.TokenAllocations);
+    Lookahead->Location = Span(Subtree->Location.Begin, Subtree->Location.Begin + First->Location.Length());
+    return Lookahead;
+  }
+
+  bool Parser::AppendReusedList(const std::shared_ptr<Token> &Read)
+  {
+    /* Adds the rest of a flattened list of the previous tree (see
+    FlattenList()) to the list on top of the stack at once, when 'Read'
+    starts one of its tails and the list is in the same state as before,
+    see TreeCursor::TakeListTails(). Returns false if not. */
+
+    if (InputTokens_.Count() != 1)
+      return false;
+
+    // Popped for the same check as in AppendToList()
+    std::shared_ptr<Token> Head = Stack_.top();
+    Stack_.pop();
+
+    const std::shared_ptr<Reduction> &node = Head->ReductionData;
+    bool appended = (Head.use_count() == 1) && node && (node.use_count() == 1) &&
+      (node->Parent->TableIndex < ListProductions_.size()) && ListProductions_[node->Parent->TableIndex] &&
+      (Reuse_.TakeListTails(Read, CurrentLALR_, *node) > 0);
+
+    if (appended)
+    {
+      Head->Location = node->Location;
+      BufferPos_ = Head->Location.End;
+      HaveReduction_ = true;
+      GOLDCPP_STAT(++Stats_.ListAppends);
+    }
+
+    Stack_.push(Head);
+    return appended;
+  }
+
   ParseMessage Parser::Parse()
   {
     ParseMessage Message;
@@ -707,9 +1581,21 @@ namespace GoldCPP
     std::shared_ptr<Token> Read;
     ParseResult Action;
 
-    if (!TablesLoaded_)
+    if (!Tables_->Loaded())
       return ParseMessage::NotLoadedError;
 
+    // ===================================
+    // Go on after the last error, see RecoverErrors
+    // ===================================
+    if (RepairFailed_)
+      return Errors_[Errors_.Count() - 1].Type;
+
+    if (RepairPending_)
+    {
+      ApplyRepair();
+      RepairPending_ = false;
+    }
+
     // ===================================
     // Loop until breakable event
     // ===================================
@@ -718,7 +1604,7 @@ namespace GoldCPP
     {
       if (InputTokens_.Count() == 0)
       {
-        Read = ProduceToken();
+        Read = NextInputToken();
         InputTokens_.Push(Read);
 
         Message = ParseMessage::TokenRead;
@@ -727,7 +1613,7 @@ namespace GoldCPP
       else
       {
         Read = InputTokens_.Top();
-        CurrentPosition_ = Read->Pos;   // Update current position
+        CurrentOffset_ = Read->Location.Begin;   // Update current position
 
         if (GroupStack_.empty() == false)    // Runaway group
         {
@@ -743,40 +1629,97 @@ namespace GoldCPP
         {
           Message = ParseMessage::LexicalError;
           Done = true;
+
+          if (RecoverErrors)
+          {
+            // Unrecognized text is just dropped
+            ParseError error;
+            error.Type = Message;
+            error.Location = Read->Location;
+            error.Read = Read->Parent;
+            error.Repair = ErrorRepair::Deleted;
+            error.Dropped = Read->Location;
+            Errors_.Add(error);
+
+            Repair_.Skip = 1;
+            RepairPending_ = true;
+          }
+        }
+        else if ((ReuseMode_ == ReuseMode::Reusing) && AppendReusedList(Read))
+        {
+          InputTokens_.Dequeue();
+          Message = ParseMessage::Reduction;
+          Done = true;
         }
         else    // Finally, we can parse the token.
         {
-          Action = ParseLALR(Read);   // SAME PROCEDURE AS v1
-          switch (Action)
+          std::shared_ptr<Token> Next = Read;
+          if (Read->GetType() == Symbol::SymbolType::Nonterminal)
+            Next = ReusedLookahead(Read);   // Subtree of a previous tree, or the terminal to reduce with first
+
+          if (!Next)
           {
-            case ParseResult::Accept:
-              Message = ParseMessage::Accept;
-              Done = true;
-              break;
-            case ParseResult::InternalError:
-              Message = ParseMessage::InternalError;
-              Done = true;
-              break;
-            case ParseResult::ReduceNormal:
-              Message = ParseMessage::Reduction;
-              Done = true;
-              break;
-            case ParseResult::Shift:
-              // ParseToken() shifted the token on the front of the Token-Queue.
-              // It now exists on the Token-Stack and must be eliminated from the queue.
-              InputTokens_.Dequeue();
-              break;
-            case ParseResult::SyntaxError:
-              Message = ParseMessage::SyntaxError;
-              Done = true;
-              break;
-            default:
-              break;
-          } // switch
+            // The subtree does not fit here, continue with its branches
+            InputTokens_.Dequeue();
+            Reuse_.Descend();
+          }
+          else
+          {
+            Action = ParseLALR(Next);   // SAME PROCEDURE AS v1
+            switch (Action)
+            {
+              case ParseResult::Accept:
+                PinTables();
+                Message = ParseMessage::Accept;
+                Done = true;
+                break;
+              case ParseResult::InternalError:
+                Message = ParseMessage::InternalError;
+                Done = true;
+                break;
+              case ParseResult::ReduceNormal:
+                Message = ParseMessage::Reduction;
+                Done = true;
+                break;
+              case ParseResult::Shift:
+                // ParseToken() shifted the token on the front of the Token-Queue.
+                // It now exists on the Token-Stack and must be eliminated from the queue.
+                InputTokens_.Dequeue();
+                if (Read->GetType() == Symbol::SymbolType::Nonterminal)
+                  Reuse_.Advance();
+                break;
+              case ParseResult::SyntaxError:
+                Message = ParseMessage::SyntaxError;
+                Done = true;
+
+                if (RecoverErrors)
+                {
+                  ParseError error;
+                  error.Type = Message;
+                  error.Location = Next->Location;
+                  error.Read = Next->Parent;
+                  error.Expected = ExpectedSymbols_;
+                  if (Next == Read)
+                    PlanRepair(error);
+                  Errors_.Add(error);
+
+                  if (error.Repair == ErrorRepair::None)
+                    RepairFailed_ = true;
+                  else
+                    RepairPending_ = true;
+                }
+                break;
+              default:
+                break;
+            } // switch
+          }
         } // if
       } // if
     } // while
 
+    if ((Message == ParseMessage::LexicalError) || (Message == ParseMessage::SyntaxError) || (Message == ParseMessage::GroupError))
+      GOLDCPP_TRACE_EVENT(Error, Message, CurrentOffset_);
+
     return Message;
   }
 }
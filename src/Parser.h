@@ -2,13 +2,17 @@
 #define GOLDCPP_PARSER_H
 
 #include "String.h"
-#include "Symbol.h"
-#include "FaState.h"
-#include "CharacterSet.h"
-#include "Production.h"
-#include "LrState.h"
+#include "GrammarTables.h"
+#include "ParseStats.h"
+#include "TraceRecorder.h"
 #include "Token.h"
-#include "Group.h"
+#include "TokenStack.h"
+#include "SourceText.h"
+#include "TextEdit.h"
+#include "TreeCursor.h"
+#include "LexerCheckpoint.h"
+#include "ParserState.h"
+#include <cstdint>
 
 // Not used, but included for consumers
 #include "Reduction.h"
@@ -39,72 +43,141 @@ namespace GoldCPP
     InternalError = 6
   };
 
-  class GrammarProperties
+  // How parsing went on after an error, see Parser::RecoverErrors
+  enum class ErrorRepair
   {
+    None = 0,             // No repair was found, parsing cannot go on
+    Inserted = 1,         // A missing terminal was inserted in front of the token read
+    Deleted = 2,          // The token read was dropped
+    Skipped = 3           // Input was dropped up to a synchronizing terminal and the stack unwound
+  };
 
-  private:
-    #define GOLD_CPP_GRAMMAR_PROPERTY_COUNT 8
-    GPSTR_T _Properties[GOLD_CPP_GRAMMAR_PROPERTY_COUNT];
-
-  public:
-    enum PropertyIndex
-    {
-      PropName = 0,
-      PropVersion = 1,
-      PropAuthor = 2,
-      PropAbout = 3,
-      PropCharacterSet = 4,
-      PropCharacterMapping = 5,
-      PropGeneratedBy = 6,
-      PropGeneratedDate = 7
-    };
-
-    GPSTR_T getProperty(PropertyIndex index) const;
-    void setProperty(PropertyIndex index, const GPSTR_T &val);
+  struct ParseError
+  {
+    ParseMessage Type;      // LexicalError or SyntaxError
+    Span Location;          // Of the token read
+    const Symbol *Read;
+    const SymbolIdSet *Expected;    // What the parser expected instead, for syntax errors
+    ErrorRepair Repair;
+    const Symbol *Inserted;     // The terminal inserted, if Repair is Inserted
+    Span Dropped;           // The input dropped, if Repair is Deleted or Skipped
+
+    ParseError() :
+      Type(ParseMessage::SyntaxError), Read(NULL), Expected(NULL), Repair(ErrorRepair::None), Inserted(NULL)
+    {}
   };
 
+  class ReloadableGrammar;
+
   class Parser
   {
   private:
 
     static const GPSTR_T kVersion_;
+    static const SymbolIdSet kNoSymbols_;
 
-    // ===== Symbols recognized by the system
-    SymbolList SymbolTable_;
+    // ===== Tables, shared with other Parsers unless OwnTables_
+    std::shared_ptr<const GrammarTables> Tables_;   // Used for parsing
+    std::shared_ptr<GrammarTables> OwnTables_;      // Tables_ if loaded by LoadTables() and not shared, so they may be changed
+    const ReloadableGrammar *Follow_;     // Where to take new tables from on Open(), see Follow()
+    uint64_t FollowedVersion_;
 
-    // ===== DFA
-    FaStateList DFA_;
-    CharacterSetList CharSetTable_;
-    GPSTR_T LookaheadBuffer_;
-
-    // ===== Productions
-    ProductionList ProductionTable_;
+    // ===== Input
+    static const GPSTR_T kNoText_;
+    std::shared_ptr<SourceText> Source_;  // Given to the tokens read, NULL until Open()
+    const GPSTR_T *Text_;         // Of Source_
+    size_t BufferPos_;            // Start of the unconsumed part of Text_
 
     // ===== LALR
-    LRStateList LRStates_;
     uint16_t CurrentLALR_;
     TokenStack Stack_;
 
     // ===== Used for Reductions & Errors
-    SymbolList ExpectedSymbols_;       // This ENTIRE list will available to the user
+    const SymbolIdSet *ExpectedSymbols_;   // Of the state a syntax error was found in, NULL if none
     bool HaveReduction_;
 
     // ===== Private control variables
-    bool TablesLoaded_;
     TokenQueueStack InputTokens_;  // Tokens to be analyzed - Hybred object!
 
     // === Line and column information.
-    Position SysPosition_;        // Internal - so user cannot mess with values
-    Position CurrentPosition_;    // Last read terminal
+    // Only offsets are tracked while parsing, lines and columns are looked up in Source_ when asked for.
+    size_t CurrentOffset_;        // Last read terminal
 
     // ===== Lexical Groups
     TokenStack GroupStack_;
-    GroupList GroupTable_;
+
+    // ===== Reuse of a previous tree, see Open()
+    enum class ReuseMode
+    {
+      Off,          // Tokens come from the lexer only
+      Lexing,       // Lexing again until the tokens line up with the previous tree
+      Reusing       // Taking input from the previous tree
+    };
+    ReuseMode ReuseMode_;
+    TreeCursor Reuse_;
+
+    // ===== Error recovery, see RecoverErrors
+    struct Repair
+    {
+      std::shared_ptr<Token> Insert;    // Token to put in front of the input
+      size_t Pops;                      // Tokens to pop off the stack
+      size_t Skip;                      // Tokens to drop from the input queue
+
+      Repair() :
+        Pops(0), Skip(0)
+      {}
+    };
+    Vector<ParseError> Errors_;
+    Repair Repair_;
+    bool RepairPending_;                // Parse() returned an error, repair it on the next call
+    bool RepairFailed_;
+    std::vector<bool> SyncSymbols_;     // Indexed by Symbol::TableIndex
+
+    // ===== Flattened lists, see FlattenList()
+    static const size_t kMaxListTail = 4;
+    std::vector<bool> ListProductions_; // Indexed by Production::TableIndex
+
+    // ===== Table use, see RecordProfile()
+    TableProfile *Profile_;
+
+#ifdef GOLDCPP_STATS
+    ParseStats Stats_;
+#endif
+
+#ifdef GOLDCPP_TRACE
+    TraceRecorder *Trace_;
+#endif
+
+    // ===== Lexer checkpoints, see RecordCheckpoints()
+    size_t TokenCount_;               // Tokens read since Open() or RestoreLexer()
+    LexerCheckpointList *Checkpoints_;
+    size_t CheckpointInterval_;
+    size_t NextCheckpoint_;
+    size_t LexReach_;                 // One past the furthest character the DFA looked at, see GetLexReach()
 
     ParseResult ParseLALR(const std::shared_ptr<Token> &NextToken);
     std::shared_ptr<Token> LookaheadDFA();
     void ConsumeBuffer(size_t charCount);
+    void SkipNoise();
+    void ScanGroupBody();
+    void SaveCheckpoint();
+    void CountAction(uint16_t state, const LRAction *action);
+    void StoreState(ParserState &state) const;
+    void LoadState(const ParserState &state);
+    void CollectInput(size_t from, size_t count, std::vector<std::shared_ptr<Token>> &out);
+    size_t TryInput(size_t pops, const std::vector<std::shared_ptr<Token>> &input);
+    void PlanRepair(ParseError &error);
+    void ApplyRepair();
+    std::shared_ptr<Token> NextInputToken();
+    std::shared_ptr<Token> TakeReusedInput();
+    std::shared_ptr<Token> ReusedLookahead(const std::shared_ptr<Token> &Subtree);
+    bool AppendReusedList(const std::shared_ptr<Token> &Read);
     std::shared_ptr<Token> ProduceToken();
+    bool AppendToList(const Production *Prod, std::shared_ptr<Token> &Head);
+    void LabelBranch(std::shared_ptr<Token> &Branch, uint16_t symbolId);
+    static bool IsListProduction(const Production &prod);
+    bool FollowTables();
+    void PinTables();
 
 #ifndef __GNUC__
     Parser(const Parser& that){};
@@ -118,6 +191,20 @@ namespace GoldCPP
     contains a single element. */
     bool TrimReductions;
 
+    /* Determines if runs of noise characters (such as whitespace) outside of
+    groups are skipped without running the DFA. Skipped runs produce no token,
+    so they are not reported with a TokenRead message. */
+    bool SkipNoiseRuns;
+
+    /* Determines if parsing goes on after syntax and lexical errors. Parse()
+    still returns each error, and the next call to Parse() repairs it: by
+    inserting or deleting a single token if the following tokens can then be
+    parsed, otherwise by dropping input up to a synchronizing terminal (see
+    AddSyncSymbol()) and popping the stack back to a state that can go on from
+    there. All errors and their repairs are listed by GetErrors(). If an error
+    cannot be repaired, Parse() keeps returning it. */
+    bool RecoverErrors;
+
     /* Returns information about the current grammar. */
     GrammarProperties Grammar;
 
@@ -126,13 +213,38 @@ namespace GoldCPP
     /* Specifies the text to be parsed */
     bool Open(const GPSTR_T &source);
 
+    /* Specifies the text to be parsed, which the tokens read refer to for
+    their line and column (see Token::GetPosition()). */
+    bool Open(const std::shared_ptr<SourceText> &source);
+
+    /* Specifies the text to be parsed after 'edit' was made to the text that
+    'previousTree' was parsed from. Only the tokens around the edit are lexed
+    again, and subtrees of the previous tree are reused wherever the parser
+    is in the same state as when they were first parsed. Reused subtrees are
+    handed out by Parse() as TokenRead of a Nonterminal and are not reported
+    again as Reduction. A reused subtree is moved to its new location without
+    visiting its branches, whose Location stays as it was and is shifted by
+    the nodes above them instead (see Reduction::GetShift()), so the work is
+    about proportional to the text lexed again and the depth of the tree at
+    the edit. A flattened list (see FlattenList()) with the edit in it is
+    made again by copying the pointers to its items before and behind the
+    edit, without parsing them again, and its items behind the edit are
+    reported as a single Reduction. Lists that are not flattened are reduced
+    again from the edit to their end, one tail at a time.
+    'previousTree' must be a tree of Reductions built by a parser with the same
+    tables (as in SimpleParser::Root). Its nodes are taken over by the new tree
+    and updated in place, so it must not be used as a previous tree again.
+    The SourceText it was read from is given the new text. */
+    bool Open(const GPSTR_T &source, const std::shared_ptr<Reduction> &previousTree, const TextEdit &edit);
+
     /* Restarts the parser. Loaded tables are retained.
     Open() calls this internally,
     so there is rarely a need to call Restart() manually. */
     void Restart();
 
     /* When the Parse() method returns a Reduce, this method will
-    contain the current Reduction. */
+    contain the current Reduction. On Accept, it is the root of the tree,
+    which keeps the tables the tree points into for as long as it is held. */
     std::shared_ptr<Reduction> GetCurrentReduction();
 
     void SetCurrentReduction(const std::shared_ptr<Reduction> &value);
@@ -140,6 +252,14 @@ namespace GoldCPP
     /* Current line and column being read from the source. */
     Position GetCurrentPosition() const;
 
+    /* Line and column of a character offset in the source, such as
+    Token::Location.Begin. Only valid while the same source is open. */
+    Position GetPosition(size_t offset) const;
+
+    /* The text being parsed, as given to Open(). Token and Reduction
+    locations are offsets into this string. */
+    const GPSTR_T& GetSource() const;
+
     /* If the Parse() function returns TokenRead,
     this method will return that last read token. */
     std::shared_ptr<Token> GetCurrentToken() const;
@@ -154,6 +274,66 @@ namespace GoldCPP
     This token will be analyzed next. */
     void PushInput(const std::shared_ptr<Token> &token);
 
+    /* Reads the next token from the input the same way Parse() does, but
+    without parsing it. Noise and Error tokens are returned as well, and the
+    End token once the input is exhausted. Used for lexing only. */
+    std::shared_ptr<Token> ReadToken();
+
+    /* While lexing, adds a checkpoint to 'checkpoints' about every 'interval'
+    characters, starting at the current offset. Checkpoints are also taken
+    inside groups. Pass NULL to stop recording. */
+    void RecordCheckpoints(LexerCheckpointList *checkpoints, size_t interval);
+
+    /* Continues lexing from 'checkpoint', which must have been taken on a text
+    identical to the open one up to the checkpoint's offset. */
+    void RestoreLexer(const LexerCheckpoint &checkpoint);
+
+    /* One past the furthest offset the lexer has looked at since Open() or
+    RestoreLexer(), which is behind the end of the last token read, as the DFA
+    looks at the character after it (the end of the text counts as one).
+    Tokens read so far stay the same if the text is edited there or behind. */
+    size_t GetLexReach() const;
+
+    /* Saves the state of the parser in constant time, so that parsing can be
+    continued from here later with RestoreState(), such as for backtracking.
+    Returns false while a previous tree is reused (see Open()), whose nodes
+    are updated in place and cannot be restored.
+    Tokens that would be changed in place on the stack (as trimmed reductions
+    and SetCurrentReduction() do) are copied first if a saved state holds them. */
+    bool SaveState(ParserState &state) const;
+
+    /* Continues parsing from a saved state. The source must be the same as when
+    the state was saved. */
+    void RestoreState(const ParserState &state);
+
+    /* Makes the terminal named 'name' a point to resume parsing at after an
+    error that cannot be repaired by a single token. If none are set, any
+    terminal can be. Returns false if there is no such terminal. */
+    bool AddSyncSymbol(const GPSTR_T &name);
+
+    /* Builds each list of the nonterminal named 'name' as a single node with
+    a branch per item, rather than nesting a node per item as deep as the list
+    is long. Lists are made by left-recursive productions such as
+    <List> ::= <List> ',' <Item>. The first reduction by one makes a node as
+    usual, and the following ones add their tail (',' and <Item> here) to that
+    node instead of making a new one. The first branch is the start of the
+    list, made by another production of <List> (or <Item> itself, if
+    <List> ::= <Item> is trimmed, see TrimReductions). Parse() still returns
+    Reduction each time, with the grown node as GetCurrentReduction().
+    A node held elsewhere, such as on the stack of a saved state, is left as it
+    is, and a new node is made instead. Returns false if 'name' has no such
+    production with a tail of up to 4 symbols. */
+    bool FlattenList(const GPSTR_T &name);
+
+    /* Flattens the lists of all nonterminals that have a single recursive
+    production, which is a list production (see FlattenList()), such as
+    <Params> and <Stmts> but not <Expr> ::= <Expr> '+' <Term> | <Expr> '-' <Term>.
+    Returns the number of nonterminals whose lists are flattened. */
+    size_t FlattenLists();
+
+    /* Errors found since the source was opened, see RecoverErrors. */
+    const Vector<ParseError>& GetErrors() const;
+
     GPSTR_T LookaheadBuffer(size_t count) const;
 
     GPCHR_T Lookahead(size_t charIndex) const;
@@ -166,19 +346,122 @@ namespace GoldCPP
     so there is rarely a need to call Clear() manually. */
     void Clear();
 
-    /* Loads parse tables from the specified BinaryReader. Only EGT (version 5.0) is supported. */
+    /* Loads parse tables from the specified BinaryReader. Only EGT (version 5.0) is supported.
+    On failure, no tables are left loaded and GetLoadError() tells why. */
     bool LoadTables(const uint8_t* binstream, size_t len);
 
-    /* Returns a list of Symbols recognized by the grammar. */
-    SymbolList GetSymbolTable() const;
+    /* What was wrong with the tables the last LoadTables() call failed on. */
+    const EgtError& GetLoadError() const;
+
+    /* Parses with tables shared with other Parsers, such as from
+    GrammarRegistry or ShareTables(), instead of loading them. The tables
+    cannot be changed through this Parser then: OptimizeDFA(), HashKeywords(),
+    EliminateUnitProductions() and ApplyProfile() have no effect. Returns
+    false if 'tables' were not loaded. */
+    bool UseTables(const std::shared_ptr<const GrammarTables> &tables);
+
+    /* Hands out the tables, so other Parsers can use them (see UseTables()).
+    From then on they cannot be changed through this Parser either. */
+    std::shared_ptr<const GrammarTables> ShareTables();
+
+    /* Parses with the current tables of 'grammar', switching to new ones
+    whenever they were replaced before Open() is called. A source that is
+    open is parsed to the end with the tables it was opened with. Synchronizing
+    terminals (see AddSyncSymbol()) and flattened lists (see FlattenList()) are
+    looked up again by name in new tables, and a previous tree given to Open()
+    is not reused if it was parsed with other tables. The tables are shared, as with UseTables(). Pass NULL to stop
+    following, keeping the tables in use; Clear(), LoadTables() and UseTables()
+    stop it too. Returns false if 'grammar' has no tables yet. */
+    bool Follow(const ReloadableGrammar *grammar);
+
+    /* Minimizes the DFA, merges equal character sets and numbers the states
+    in breadth-first order from the initial state, so the states used most
+    are close together in memory. Tokens are the same as before.
+    Call after LoadTables(), not on shared tables (see UseTables()). */
+    void OptimizeDFA();
+
+    /* Size of the DFA tables, such as before and after OptimizeDFA(). */
+    DfaStats GetDfaStats() const;
+
+    /* Memory used by the loaded tables, see MemoryUsage.h for the size of
+    a parse tree. Tables shared with other Parsers are counted in full. */
+    TableMemory GetTableMemory() const;
+
+    /* Takes keywords out of the DFA and recognizes them by a perfect hash of
+    the token text instead, which makes the DFA smaller when a grammar has
+    many keywords. Keywords here are terminals that match a single literal
+    string which would otherwise continue into another terminal, usually an
+    identifier (see KeywordTable::Extract()). The DFA accepts them as that
+    terminal and is then optimized (see OptimizeDFA()), which merges the
+    states of the keywords into those of the identifier. Tokens are the same as before.
+    Keywords of case insensitive grammars are taken out too, if their letters
+    are all ASCII. Call after LoadTables(). Returns the number of keywords taken out. */
+    size_t HashKeywords();
+
+    /* While parsing or lexing, counts in 'profile' how often each DFA state
+    and edge and each LALR state and action is used. Counts add up over
+    several sources, unless the profile was recorded on other tables, in
+    which case it is reset first. Pass NULL to stop recording. */
+    void RecordProfile(TableProfile *profile);
+
+    /* Reorders the tables by a profile, such as one recorded on sample input
+    and saved with TableProfile::Save(): the most used states come first,
+    and so do the most used edges and actions of each state. The profile
+    must have been recorded on tables in the same layout, that is, loaded
+    from the same EGT and changed the same way (see OptimizeDFA() and
+    HashKeywords()). Returns false, leaving the tables as they are, if it
+    was not. Call before Open(). */
+    bool ApplyProfile(const TableProfile &profile);
+
+    /* Takes reductions by unit productions, those whose handle is a single
+    nonterminal (<Value> ::= <Term>), out of the LALR tables where it can, so
+    chains of them, such as through the precedence levels of an expression
+    grammar, take no steps at all. A state reached on <Term> that would only
+    reduce to <Value> gets a copy that does right away what the state reached
+    on <Value> does, so the tables grow by those copies. Parse() returns no
+    Reduction for <Value> then, and the <Term> token goes into the tree in
+    its place, labeled <Value>, as TrimReductions would leave it. Unit
+    reductions the tables still make are returned and trimmed as before.
+    Error recovery may repair errors differently. Call after LoadTables(),
+    and before ApplyProfile(), whose profile must be recorded on the changed
+    tables. GrammarTables::Save() keeps the change. Returns the number of
+    gotos changed. */
+    size_t EliminateUnitProductions();
+
+#ifdef GOLDCPP_STATS
+    /* Counts and times of what the parser did since Open(). Only there if
+    GOLDCPP_STATS is defined, see ParseStats.h. */
+    const ParseStats& GetStats() const;
+#endif
 
-    /* Returns a list of Productions recognized by the grammar. */
-    ProductionList GetProductionTable() const;
+#ifdef GOLDCPP_TRACE
+    /* Reports tokens, shifts, reductions, groups and errors to 'recorder'
+    as they happen. Pass NULL to stop. Only there if GOLDCPP_TRACE is
+    defined, see TraceRecorder.h. */
+    void SetTraceRecorder(TraceRecorder *recorder);
+#endif
+
+    /* Returns a list of Symbols recognized by the grammar, indexed by Symbol::TableIndex. */
+    const SymbolList& GetSymbolTable() const;
+
+    /* Returns a list of Productions recognized by the grammar, indexed by Production::TableIndex. */
+    const ProductionList& GetProductionTable() const;
+
+    /* Symbols and Productions by their id (TableIndex). Ids are stable until
+    other tables are loaded. */
+    size_t GetSymbolCount() const;
+    const Symbol& GetSymbol(uint32_t id) const;
+    size_t GetProductionCount() const;
+    const Production& GetProduction(uint16_t id) const;
 
     /* If the Parse() method returns a SyntaxError, this method will contain a list of
     the symbols the grammar expected to see. */
     SymbolList GetExpectedSymbols() const;
 
+    /* Same as GetExpectedSymbols(), as Symbol::TableIndex values. Refers into
+    the tables, so nothing is copied. */
+    const SymbolIdSet& GetExpectedSymbolIds() const;
+
     /* Returns true if parse tables were loaded. */
     bool TablesLoaded() const;
 
@@ -0,0 +1,44 @@
+#ifndef GOLDCPP_PARSERSTATE_H
+#define GOLDCPP_PARSERSTATE_H
+
+#include "Token.h"
+#include "TokenStack.h"
+#include "SymbolIdSet.h"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace GoldCPP
+{
+  /* The complete state of a Parser between two calls to Parse(), see
+  Parser::SaveState(). The stacks are shared with the parser until either
+  side changes them, so saving a state takes constant time.
+  A state is only meaningful to a parser with the same tables and source. */
+  struct ParserState
+  {
+    uint16_t CurrentLALR;
+    TokenStack Stack;
+    TokenQueueStack InputTokens;
+    TokenStack GroupStack;
+    const SymbolIdSet *ExpectedSymbols;
+    bool HaveReduction;
+    size_t BufferPos;
+    size_t CurrentOffset;
+    size_t TokenCount;
+
+    // Error recovery
+    size_t ErrorCount;
+    bool RepairPending;
+    bool RepairFailed;
+    std::shared_ptr<Token> RepairInsert;
+    size_t RepairPops;
+    size_t RepairSkip;
+
+    ParserState()
+      : CurrentLALR(0), ExpectedSymbols(NULL), HaveReduction(false), BufferPos(0), CurrentOffset(0), TokenCount(0),
+        ErrorCount(0), RepairPending(false), RepairFailed(false), RepairPops(0), RepairSkip(0)
+    {}
+  };
+}
+
+#endif // GOLDCPP_PARSERSTATE_H
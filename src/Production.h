@@ -4,6 +4,7 @@
 #include "String.h"
 #include "Symbol.h"
 #include "Vector.h"
+#include "StringPool.h"
 
 #include <cstdint>
 
@@ -12,19 +13,50 @@ namespace GoldCPP
   struct Production
   {
     Symbol* Head;
-    SymbolList Handle;
+    SymbolIdSpan Handle;    // Symbol ids stored in the parser tables
     uint16_t TableIndex;
 
     Production() :
-      Head(NULL), Handle(0), TableIndex((uint16_t)-1)
+      Head(NULL), Handle(), TableIndex((uint16_t)-1), Text_(NULL), DelimitedText_(NULL)
     {}
 
     Production(Symbol *head, uint16_t tableIndex) :
-      Head(head), Handle(0), TableIndex(tableIndex)
+      Head(head), Handle(), TableIndex(tableIndex), Text_(NULL), DelimitedText_(NULL),
+      OwnText_(BuildText(false)), OwnDelimitedText_(BuildText(true))
     {}
 
-    GPSTR_T GetText(bool AlwaysDelimitTerminals = false) const
+    Production(Symbol *head, const SymbolIdSpan &handle, uint16_t tableIndex) :
+      Head(head), Handle(handle), TableIndex(tableIndex), Text_(NULL), DelimitedText_(NULL),
+      OwnText_(BuildText(false)), OwnDelimitedText_(BuildText(true))
+    {}
+
+    /* Display text, such as <A> ::= <B> c. Rendered once by RenderText()
+    when the tables are loaded. Productions that were not rendered keep both
+    texts in strings of their own, built when they are constructed from the
+    head and handle given then. Copies share the rendered texts, as they
+    point into the same tables. */
+    const GPSTR_T& GetText(bool AlwaysDelimitTerminals = false) const
+    {
+      const GPSTR_T *text = AlwaysDelimitTerminals ? DelimitedText_ : Text_;
+      if (text)
+        return *text;
+
+      return AlwaysDelimitTerminals ? OwnDelimitedText_ : OwnText_;
+    }
+
+    /* Renders the display texts into 'pool'. The symbols must be rendered first. */
+    void RenderText(StringPool &pool)
     {
+      Text_ = &pool.Intern(BuildText(false));
+      DelimitedText_ = &pool.Intern(BuildText(true));
+      GPSTR_T().swap(OwnText_);
+      GPSTR_T().swap(OwnDelimitedText_);
+    }
+
+    GPSTR_T BuildText(bool AlwaysDelimitTerminals) const
+    {
+      if (!Head)
+        return GPSTR_T();
       return Head->GetText() + GPSTR_C(" ::= ") + Handle.GetText(GPSTR_C(" "), AlwaysDelimitTerminals);
     }
 
@@ -38,6 +70,12 @@ namespace GoldCPP
 
       return false;
     }
+
+  private:
+    const GPSTR_T *Text_;
+    const GPSTR_T *DelimitedText_;    // With AlwaysDelimitTerminals
+    GPSTR_T OwnText_;                 // Used if not rendered
+    GPSTR_T OwnDelimitedText_;
   };
 
   typedef Vector<Production> ProductionList;
@@ -2,28 +2,203 @@
 #define GOLDCPP_REDUCTION_H
 
 #include "Token.h"
+#include "Span.h"
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <cassert>
+#include <cstddef>
 
 namespace GoldCPP
 {
   struct Production;
 
+  /* The branches of a Reduction, as many as its production has handle
+  symbols, or more for a flattened list (see Parser::FlattenList()). Most
+  productions have 3 or fewer, which are kept in the list object itself, so
+  such a Reduction takes a single allocation together with its shared_ptr
+  (see std::make_shared()). Longer lists go to the heap. */
+  class BranchList
+  {
+  public:
+    static const size_t kInlineCount = 3;
+
+  private:
+    typedef std::shared_ptr<Token> Item;
+    typedef std::aligned_storage<sizeof(Item), std::alignment_of<Item>::value>::type ItemStorage;
+
+    struct HeapItems
+    {
+      Item *Items;
+      size_t Capacity;
+    };
+
+    size_t Count_;
+    union
+    {
+      ItemStorage Inline_[kInlineCount];    // Used if Count_ <= kInlineCount
+      HeapItems Heap_;
+    };
+
+    Item* Items()
+    {
+      return (Count_ <= kInlineCount) ? reinterpret_cast<Item*>(Inline_) : Heap_.Items;
+    }
+
+    const Item* Items() const
+    {
+      return (Count_ <= kInlineCount) ? reinterpret_cast<const Item*>(Inline_) : Heap_.Items;
+    }
+
+    // Not new[], which would put the count in front of the items again
+    static Item* Allocate(size_t capacity)
+    {
+      return static_cast<Item*>(::operator new(capacity * sizeof(Item)));
+    }
+
+    /* Makes 'n' items, copies of 'from' if it is given. */
+    void Create(size_t n, const Item *from)
+    {
+      Count_ = n;
+      if (Count_ > kInlineCount)
+      {
+        Heap_.Items = Allocate(Count_);
+        Heap_.Capacity = Count_;
+      }
+
+      Item *items = Items();
+      for (size_t i = 0; i < Count_; ++i)
+      {
+        if (from)
+          new (&items[i]) Item(from[i]);
+        else
+          new (&items[i]) Item();
+      }
+    }
+
+    void Destroy()
+    {
+      Item *items = Items();
+      for (size_t i = 0; i < Count_; ++i)
+        items[i].~Item();
+
+      if (Count_ > kInlineCount)
+        ::operator delete(Heap_.Items);
+      Count_ = 0;
+    }
+
+  public:
+
+    explicit BranchList(size_t n)
+    {
+      Create(n, NULL);
+    }
+
+    BranchList(const BranchList &that)
+    {
+      Create(that.Count_, that.Items());
+    }
+
+    BranchList& operator= (const BranchList &that)
+    {
+      if (this != &that)
+      {
+        Destroy();
+        Create(that.Count_, that.Items());
+      }
+      return *this;
+    }
+
+    ~BranchList()
+    {
+      Destroy();
+    }
+
+    size_t Count() const
+    {
+      return Count_;
+    }
+
+    /* Adds a branch at the end. Lists are only grown, so they stay on the
+    heap once they went there. */
+    void Add(const Item &item)
+    {
+      Item *items = Items();
+      if ((Count_ == kInlineCount) || ((Count_ > kInlineCount) && (Count_ == Heap_.Capacity)))
+      {
+        Item *grown = Allocate(2 * Count_);
+        for (size_t i = 0; i < Count_; ++i)
+        {
+          new (&grown[i]) Item(std::move(items[i]));
+          items[i].~Item();
+        }
+
+        if (Count_ > kInlineCount)
+          ::operator delete(Heap_.Items);
+        Heap_.Items = grown;
+        Heap_.Capacity = 2 * Count_;
+        items = grown;
+      }
+
+      new (&items[Count_]) Item(item);
+      ++Count_;
+    }
+
+    /* Heap memory used by the list, see MemoryUsage.h. */
+    size_t HeapBytes() const
+    {
+      return (Count_ <= kInlineCount) ? 0 : Heap_.Capacity * sizeof(Item);
+    }
+
+    Item& operator[] (size_t index)
+    {
+      assert(index < Count_);
+      return Items()[index];
+    }
+
+    const Item& operator[] (size_t index) const
+    {
+      assert(index < Count_);
+      return Items()[index];
+    }
+  };
+
+  /* sizeof(Reduction) is 112 bytes on 64-bit systems, with up to
+  BranchList::kInlineCount branches in it. */
   struct Reduction
   {
-    TokenList Branches;
-    Production *Parent;
+    BranchList Branches;
+    const Production *Parent;
     void *User;
+    Span Location;      // From the start of the first branch to the end of the last one, the same as the token holding it
+
+    /* Incremental parses (see Parser::Open()) move the subtrees they reuse
+    along with the text, without updating the locations in them. How far the
+    branches of a node were moved is noted in the node instead: Shift for all
+    of them, and ShiftBy more for those from ShiftFrom on. See GetShift(). */
+    ptrdiff_t Shift;
+    size_t ShiftFrom;
+    ptrdiff_t ShiftBy;
 
     Reduction(size_t n) :
-      Branches(n, NULL),
+      Branches(n),
       Parent(NULL),
-      User(NULL)
+      User(NULL),
+      Location(),
+      Shift(0),
+      ShiftFrom(0),
+      ShiftBy(0)
     {}
+
+    /* How far branch 'i' was moved from its Location. Where a branch is in
+    the source is its Location shifted by this and by the shifts of the
+    branches above it, down from the root of the tree, whose own Location is
+    in the source. Always 0 in trees parsed without reuse. */
+    ptrdiff_t GetShift(size_t i) const
+    {
+      return (i < ShiftFrom) ? Shift : Shift + ShiftBy;
+    }
   };
 }
 
 #endif // GOLDCPP_REDUCTION_H
-
-
-
-
-
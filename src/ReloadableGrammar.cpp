@@ -0,0 +1,44 @@
+#include "ReloadableGrammar.h"
+
+namespace GoldCPP
+{
+  ReloadableGrammar::ReloadableGrammar() :
+    Current_(), Version_(0)
+  {
+  }
+
+  ReloadableGrammar::ReloadableGrammar(const std::shared_ptr<const GrammarTables> &tables) :
+    Current_(), Version_(0)
+  {
+    Publish(tables);
+  }
+
+  std::shared_ptr<const GrammarTables> ReloadableGrammar::Get() const
+  {
+    return std::atomic_load(&Current_);
+  }
+
+  uint64_t ReloadableGrammar::GetVersion() const
+  {
+    return Version_.load(std::memory_order_acquire);
+  }
+
+  bool ReloadableGrammar::Publish(const std::shared_ptr<const GrammarTables> &tables)
+  {
+    if (!tables || !tables->Loaded())
+      return false;
+
+    /* The tables are stored before the version is counted up, so whoever sees
+    the new version gets the new tables. The old tables are freed here only
+    if no Parser holds them anymore. */
+    std::atomic_store(&Current_, tables);
+    Version_.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  bool ReloadableGrammar::Reload(const uint8_t* egt, size_t len, unsigned prepare, EgtError *error)
+  {
+    std::shared_ptr<const GrammarTables> tables = GrammarRegistry::Global().Acquire(egt, len, prepare, error);
+    return Publish(tables);
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef GOLDCPP_RELOADABLEGRAMMAR_H
+#define GOLDCPP_RELOADABLEGRAMMAR_H
+
+#include "GrammarTables.h"
+#include "GrammarRegistry.h"
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* The current tables of a grammar, which can be replaced while Parsers in
+  other threads use it, such as by a new version of the grammar in a running
+  service. Parsers following it (see Parser::Follow()) take the current tables
+  whenever they open a source. Parses already going on when the tables are
+  replaced finish with the tables they started with, and old tables are freed
+  when the last Parser holding them lets go. Nothing is ever changed in place:
+  new tables are loaded and prepared on the side, by whichever thread calls
+  Publish() or Reload(), and then swapped in. Parsers only wait for the swap
+  itself, never for a load. The root of a tree keeps the tables it was
+  parsed with (see Parser::GetCurrentReduction()).
+  All methods may be called from any thread. This object must outlive the
+  Parsers following it. */
+  class ReloadableGrammar
+  {
+  private:
+    std::shared_ptr<const GrammarTables> Current_;    // Only accessed by std::atomic_load() and std::atomic_store()
+    std::atomic<uint64_t> Version_;
+
+#ifndef __GNUC__
+    ReloadableGrammar(const ReloadableGrammar& that){}
+#else
+    ReloadableGrammar(const ReloadableGrammar& that) = delete;
+#endif
+
+  public:
+
+    ReloadableGrammar();
+    explicit ReloadableGrammar(const std::shared_ptr<const GrammarTables> &tables);
+
+    /* The current tables, NULL if none were published yet. */
+    std::shared_ptr<const GrammarTables> Get() const;
+
+    /* The number of times tables were published. Cheap enough to check
+    before every parse; the tables may be newer than the version read. */
+    uint64_t GetVersion() const;
+
+    /* Makes 'tables' the current tables. Returns false, leaving the current
+    tables as they are, if 'tables' were not loaded. */
+    bool Publish(const std::shared_ptr<const GrammarTables> &tables);
+
+    /* Loads tables from 'egt' through the process' GrammarRegistry and
+    publishes them. On failure, the current tables are kept, and 'error'
+    tells why if it is given. */
+    bool Reload(const uint8_t* egt, size_t len, unsigned prepare = GrammarRegistry::None, EgtError *error = NULL);
+  };
+}
+
+#endif // GOLDCPP_RELOADABLEGRAMMAR_H
@@ -0,0 +1,202 @@
+#include "SharedTables.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define GOLDCPP_HAVE_MMAP
+#endif
+
+#if defined(GOLDCPP_SHARED_TABLES) && defined(_GLIBCXX_USE_CXX11_ABI) && !_GLIBCXX_USE_CXX11_ABI
+  #error "Empty strings of the old libstdc++ ABI point to static data, which is elsewhere in other processes"
+#endif
+
+namespace GoldCPP
+{
+#if defined(GOLDCPP_HAVE_MMAP) && defined(GOLDCPP_SHARED_TABLES)
+  namespace
+  {
+    /* At the start of the segment. Ready is set last, so a segment that is
+    still being built is not taken for a complete one. */
+    struct SegmentHeader
+    {
+      char Magic[8];
+      uint32_t Version;
+      volatile uint32_t Ready;
+      uint64_t Address;         // Where the segment was built, and must be mapped
+      uint64_t Length;          // Of the segment, with the header
+      uint64_t Tables;          // Offset of the GrammarTables object
+      uint32_t TablesSize;      // sizeof(GrammarTables) in the build that published it
+      uint32_t StringSize;      // sizeof(GPSTR_T) likewise
+    };
+
+    const char kSegmentMagic[8] = { 'G', 'o', 'l', 'd', 'C', 'P', 'P', 'M' };
+    const uint32_t kSegmentVersion = 2;
+
+    /* Room reserved for building the tables. Pages that are not written take
+    no memory, and the segment is cut down to what was used afterwards. */
+    const size_t kRoomPerEgtByte = 64;
+    const size_t kMinRoom = 1 << 20;
+
+    /* Keeps an attached segment mapped. The tables in it are never destroyed,
+    as they were built by the publisher and are read-only here. */
+    struct Mapping
+    {
+      void *Address;
+      size_t Length;
+
+      Mapping(void *address, size_t length) :
+        Address(address), Length(length)
+      {}
+
+      ~Mapping()
+      {
+        munmap(Address, Length);
+      }
+    };
+
+    bool IsComplete(const SegmentHeader &header, size_t fileLength)
+    {
+      size_t page = (size_t)sysconf(_SC_PAGESIZE);
+      return (header.Ready == 1) && (std::memcmp(header.Magic, kSegmentMagic, sizeof(kSegmentMagic)) == 0) &&
+        (header.Version == kSegmentVersion) && (header.TablesSize == sizeof(GrammarTables)) &&
+        (header.StringSize == sizeof(GPSTR_T)) && (header.Address != 0) && (header.Address % page == 0) &&
+        (header.Length <= fileLength) && (header.Length >= sizeof(GrammarTables)) &&
+        (header.Tables >= sizeof(SegmentHeader)) && (header.Tables <= header.Length - sizeof(GrammarTables));
+    }
+  }
+
+  static int OpenSegment(const char *name, SharedTableSegment::Kind kind, int flags, mode_t mode)
+  {
+    if (kind == SharedTableSegment::Kind::SharedMemory)
+      return shm_open(name, flags, mode);
+    return open(name, flags, mode);
+  }
+#endif
+
+  bool SharedTableSegment::Publish(const char *name, const GrammarTables &tables, Kind kind)
+  {
+#if defined(GOLDCPP_HAVE_MMAP) && defined(GOLDCPP_SHARED_TABLES)
+    // The copy is loaded from saved tables, so that it allocates everything while the segment's arena is current
+    std::vector<uint8_t> data;
+    if (!tables.Save(data))
+      return false;
+
+    int fd = OpenSegment(name, kind, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+      return false;
+
+    const size_t align = alignof(std::max_align_t);
+    size_t headerLength = (sizeof(SegmentHeader) + align - 1) & ~(align - 1);
+    size_t room = headerLength + ((kRoomPerEgtByte * data.size() > kMinRoom) ? kRoomPerEgtByte * data.size() : kMinRoom);
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)room) == 0)
+      map = mmap(NULL, room, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    bool built = false;
+    if (map != MAP_FAILED)
+    {
+      TableArena arena((uint8_t*)map + headerLength, room - headerLength);
+      GrammarTables *copy = NULL;
+      {
+        TableArena::Scope scope(&arena);
+        void *place = arena.Allocate(sizeof(GrammarTables));
+        if (place)
+        {
+          copy = new (place) GrammarTables();
+          built = copy->Load(data.data(), data.size()) && !arena.Overflowed();
+          if (!built)
+            copy->~GrammarTables();     // Frees what went to the heap
+        }
+      }
+
+      // Cut down to the pages used before the segment is marked complete
+      size_t page = (size_t)sysconf(_SC_PAGESIZE);
+      size_t length = (headerLength + arena.Used() + page - 1) & ~(page - 1);
+      built = built && (ftruncate(fd, (off_t)length) == 0);
+
+      if (built)
+      {
+        SegmentHeader *header = (SegmentHeader*)map;
+        std::memcpy(header->Magic, kSegmentMagic, sizeof(kSegmentMagic));
+        header->Version = kSegmentVersion;
+        header->Address = (uint64_t)(uintptr_t)map;
+        header->Length = length;
+        header->Tables = (uint64_t)((uint8_t*)copy - (uint8_t*)map);
+        header->TablesSize = sizeof(GrammarTables);
+        header->StringSize = sizeof(GPSTR_T);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        header->Ready = 1;
+      }
+
+      munmap(map, room);
+    }
+    close(fd);
+
+    if (!built)
+    {
+      // Leave nothing half made behind
+      Remove(name, kind);
+      return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool SharedTableSegment::Remove(const char *name, Kind kind)
+  {
+#ifdef GOLDCPP_HAVE_MMAP
+    if (kind == Kind::SharedMemory)
+      return shm_unlink(name) == 0;
+    return unlink(name) == 0;
+#else
+    return false;
+#endif
+  }
+
+  std::shared_ptr<const GrammarTables> SharedTableSegment::Attach(const char *name, Kind kind)
+  {
+#if defined(GOLDCPP_HAVE_MMAP) && defined(GOLDCPP_SHARED_TABLES)
+    int fd = OpenSegment(name, kind, O_RDONLY, 0);
+    if (fd < 0)
+      return NULL;
+
+    SegmentHeader header;
+    struct stat info;
+    void *map = MAP_FAILED;
+    if ((pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) && (fstat(fd, &info) == 0) &&
+        IsComplete(header, (size_t)info.st_size))
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      int flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+      flags |= MAP_FIXED_NOREPLACE;
+#endif
+      map = mmap((void*)(uintptr_t)header.Address, (size_t)header.Length, PROT_READ, flags, fd, 0);
+    }
+    close(fd);
+
+    if (map == MAP_FAILED)
+      return NULL;
+    if ((uintptr_t)map != header.Address)
+    {
+      // Only taken as a hint where MAP_FIXED_NOREPLACE is not known, and something else is there
+      munmap(map, (size_t)header.Length);
+      return NULL;
+    }
+
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>(map, (size_t)header.Length);
+    return std::shared_ptr<const GrammarTables>(mapping, (const GrammarTables*)((const uint8_t*)map + header.Tables));
+#else
+    return NULL;
+#endif
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef GOLDCPP_SHAREDTABLES_H
+#define GOLDCPP_SHAREDTABLES_H
+
+#include "GrammarTables.h"
+#include <memory>
+
+namespace GoldCPP
+{
+  /* Tables in memory that all processes of a host can map: a POSIX shared
+  memory object (see shm_open(), which needs -lrt with older C libraries) or
+  a file. One process publishes the tables it prepared, building them right
+  in the segment, and the others attach to it read-only and parse with the
+  tables in place. They neither load nor prepare the tables, and the tables
+  take up physical memory once per host.
+
+  The tables hold pointers, so they are mapped at the address they were built
+  at. Attaching fails if a process has something else there already; it has
+  to load the tables itself then. All processes must run the same build of
+  GoldCPP. Only available on POSIX systems, and only if everything is compiled
+  with GOLDCPP_SHARED_TABLES defined (see TableAllocator.h); otherwise every
+  call fails. */
+  class SharedTableSegment
+  {
+  public:
+
+    enum class Kind
+    {
+      SharedMemory,     // 'name' is a shared memory object, such as "/mygrammar"
+      File              // 'name' is a path
+    };
+
+    /* Builds a copy of 'tables' in a new segment. Fails if the segment exists
+    already, such as when another process published it first; attach to it
+    then. Processes attaching while it is built fail too, until it is complete. */
+    static bool Publish(const char *name, const GrammarTables &tables, Kind kind = Kind::SharedMemory);
+
+    /* Removes a segment. Processes attached to it keep their mapping. */
+    static bool Remove(const char *name, Kind kind = Kind::SharedMemory);
+
+    /* Maps a published segment read-only, and returns its tables, such as for
+    Parser::UseTables(). The segment stays mapped until the last holder of the
+    tables lets go of them. NULL if it cannot be attached. */
+    static std::shared_ptr<const GrammarTables> Attach(const char *name, Kind kind = Kind::SharedMemory);
+  };
+}
+
+#endif // GOLDCPP_SHAREDTABLES_H
@@ -22,6 +22,30 @@ namespace GoldCPP
       }
     }
 
+    SimpleParser::SimpleParser(const std::shared_ptr<const GrammarTables> &tables) :
+      parser_(NULL), User0(NULL), User1(NULL), Root(NULL)
+    {
+      parser_ = new Parser();
+
+      if (!parser_->UseTables(tables))
+      {
+        delete parser_;
+        throw std::runtime_error("Could not load EGT parser tables.");
+      }
+    }
+
+    SimpleParser::SimpleParser(const ReloadableGrammar &grammar) :
+      parser_(NULL), User0(NULL), User1(NULL), Root(NULL)
+    {
+      parser_ = new Parser();
+
+      if (!parser_->Follow(&grammar))
+      {
+        delete parser_;
+        throw std::runtime_error("Could not load EGT parser tables.");
+      }
+    }
+
     SimpleParser::~SimpleParser()
     {
       delete parser_;
@@ -37,10 +61,19 @@ namespace GoldCPP
     GPSTR_T SimpleParser::SyntaxError(SimpleParser UNUSED *parser, Parser* parserCore)
     {
       //Expecting a different token
+      const SymbolIdSet &ids = parserCore->GetExpectedSymbolIds();
+      GPSTR_T expected;
+      for (SymbolIdSet::Iterator it = ids.begin(); it != ids.end(); ++it)
+      {
+        if (!expected.empty())
+          expected += GPSTR_C(", ");
+        expected += parserCore->GetSymbol(*it).GetText();
+      }
+
       return GPSTR_T(GPSTR_C("Syntax Error:\n")) +
              GPSTR_C("Position: ") + toString(parserCore->GetCurrentPosition().Line) + GPSTR_C(", ") +  toString(parserCore->GetCurrentPosition().Column) + GPSTR_C("\n") +
              GPSTR_T(GPSTR_C("Read: ")) + parserCore->GetCurrentToken()->StringData + GPSTR_C("\n") +
-             GPSTR_T(GPSTR_C("Expecting: ")) + parserCore->GetExpectedSymbols().GetText();
+             GPSTR_T(GPSTR_C("Expecting: ")) + expected;
     }
     std::shared_ptr<Reduction> SimpleParser::Reduce(SimpleParser UNUSED *parser, const std::shared_ptr<Reduction> &reduction)
     {
@@ -74,12 +107,38 @@ namespace GoldCPP
       The resulting tree will be a pure representation of the language
       and will be ready to implement. */
 
+      parser_->Open(source);
+      parser_->TrimReductions = trimReductions;  //Please read about this feature before enabling
+      parser_->SkipNoiseRuns = true;             //We don't handle TokenRead, so whitespace needs no tokens
+
+      return Run(msgOut);
+    }
+
+    bool SimpleParser::Reparse(const GPSTR_T &source, const TextEdit &edit, GPSTR_T &msgOut, bool trimReductions)
+    {
+      /* Same as Parse(), but only the part of the source around the edit is
+      parsed again. Reduce() is only called for the new parts of the tree. */
+
+      std::shared_ptr<Reduction> previous = Root;
+      Root = NULL;
+
+      if (parser_->GetErrors().Count() > 0)
+        previous = NULL;          //Repaired trees have tokens that are not in the source
+
+      parser_->Open(source, previous, edit);
+      parser_->TrimReductions = trimReductions;  //Should be the same as for the previous tree
+      parser_->SkipNoiseRuns = true;
+
+      return Run(msgOut);
+    }
+
+    bool SimpleParser::Run(GPSTR_T &msgOut)
+    {
       ParseMessage response;
       bool done;                      //Controls when we leave the loop
       bool accepted = false;          //Was the parse successful?
-
-      parser_->Open(source);
-      parser_->TrimReductions = trimReductions;  //Please read about this feature before enabling
+      bool failed = false;            //Were there errors the parser recovered from?
+      GPSTR_T errors;
 
       done = false;
       while (!done)
@@ -90,14 +149,16 @@ namespace GoldCPP
           {
               case ParseMessage::LexicalError:
                   //Cannot recognize token
-                  msgOut = LexicalError(this, parser_);
-                  done = true;
+                  AppendError(errors, LexicalError(this, parser_));
+                  failed = true;
+                  done = !CanRecover();
                   break;
 
               case ParseMessage::SyntaxError:
                   //Expecting a different token
-                  msgOut = SyntaxError(this, parser_);
-                  done = true;
+                  AppendError(errors, SyntaxError(this, parser_));
+                  failed = true;
+                  done = !CanRecover();
                   break;
 
               case ParseMessage::Reduction:
@@ -108,7 +169,7 @@ namespace GoldCPP
                   //Accepted!
                   Root = parser_->GetCurrentReduction();    //The root node!
                   done = true;
-                  accepted = true;
+                  accepted = !failed;
                   break;
 
               case ParseMessage::TokenRead:
@@ -117,24 +178,41 @@ namespace GoldCPP
 
               case ParseMessage::InternalError:
                   //INTERNAL ERROR! Something is horribly wrong.
-                  msgOut = InternalError(this);
+                  AppendError(errors, InternalError(this));
                   done = true;
                   break;
 
               case ParseMessage::NotLoadedError:
                   //This error occurs if the EGT was not loaded.
-                  msgOut = TablesNotLoaded(this);
+                  AppendError(errors, TablesNotLoaded(this));
                   done = true;
                   break;
 
               case ParseMessage::GroupError:
                   //GROUP ERROR! Unexpected end of file
-                  msgOut = Runaway(this);
+                  AppendError(errors, Runaway(this));
                   done = true;
                   break;
           }
       } //while
 
+      if (!errors.empty())
+        msgOut = errors;
+
       return accepted;
     }
+
+    bool SimpleParser::CanRecover() const
+    {
+      //Goes on after an error only if the parser repaired it
+      const Vector<ParseError> &errors = parser_->GetErrors();
+      return parser_->RecoverErrors && (errors.Count() > 0) && (errors[errors.Count() - 1].Repair != ErrorRepair::None);
+    }
+
+    void SimpleParser::AppendError(GPSTR_T &errors, const GPSTR_T &message)
+    {
+      if (!errors.empty())
+        errors += GPSTR_C("\n\n");
+      errors += message;
+    }
 }
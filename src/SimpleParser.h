@@ -2,6 +2,7 @@
 #define GoldCPP_SIMPLEPARSER_H
 
 #include "String.h"
+#include "TextEdit.h"
 #include <memory>
 #include <sstream>
 
@@ -30,6 +31,8 @@ namespace GoldCPP
   }
 
   class Parser;
+  class GrammarTables;
+  class ReloadableGrammar;
 
   class SimpleParser
   {
@@ -42,12 +45,24 @@ namespace GoldCPP
     SimpleParser(const SimpleParser& that) = delete;
 #endif
 
+    bool Run(GPSTR_T &msgOut);
+    bool CanRecover() const;
+    static void AppendError(GPSTR_T &errors, const GPSTR_T &message);
+
   public:
     void* User0;
     void* User1;
     std::shared_ptr<Reduction> Root;
 
     SimpleParser(const uint8_t* egt_data, size_t len);
+
+    /* Parses with tables shared with other parsers, such as from
+    GrammarRegistry::Acquire(). */
+    SimpleParser(const std::shared_ptr<const GrammarTables> &tables);
+
+    /* Parses with the current tables of 'grammar', taking new ones for each
+    Parse() or Reparse() after they were replaced, see Parser::Follow(). */
+    SimpleParser(const ReloadableGrammar &grammar);
     virtual ~SimpleParser();
 
     // Override these functions to get custom behavior
@@ -58,7 +73,17 @@ namespace GoldCPP
     virtual GPSTR_T TablesNotLoaded(SimpleParser *parser);
     virtual GPSTR_T Runaway(SimpleParser *parser);
 
+    /* Parses 'source' into Root. On an error, its message is put into msgOut and
+    false is returned. If the parser core recovers from errors (see
+    Parser::RecoverErrors), parsing goes on, msgOut gets the messages of all
+    errors, and Root holds the repaired tree, but false is still returned. */
     bool Parse(const GPSTR_T &source, GPSTR_T &msgOut, bool trimReductions = false);
+
+    /* Parses 'source' after 'edit' was made to the text that Root was parsed
+    from, reusing the parts of Root not affected by the edit. Does a full
+    parse if there is no Root. The previous Root is used up either way, and
+    Root is cleared if the new text cannot be parsed. */
+    bool Reparse(const GPSTR_T &source, const TextEdit &edit, GPSTR_T &msgOut, bool trimReductions = false);
     Parser* GetParserCore() const { return parser_; }
   };
 }
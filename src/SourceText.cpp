@@ -0,0 +1,31 @@
+#include "SourceText.h"
+
+namespace GoldCPP
+{
+  SourceText::SourceText(const GPSTR_T &text) :
+    Own_(text),
+    Text_(&Own_)
+  {}
+
+  void SourceText::Assign(const GPSTR_T &text)
+  {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Own_ = text;
+    Text_ = &Own_;
+    Lines_.Clear();
+  }
+
+  void SourceText::Refer(const GPSTR_T &text)
+  {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    GPSTR_T().swap(Own_);
+    Text_ = &text;
+    Lines_.Clear();
+  }
+
+  Position SourceText::GetPosition(size_t offset) const
+  {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Lines_.Lookup(*Text_, offset);
+  }
+}
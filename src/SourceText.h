@@ -0,0 +1,55 @@
+#ifndef GOLDCPP_SOURCETEXT_H
+#define GOLDCPP_SOURCETEXT_H
+
+#include "String.h"
+#include "Position.h"
+#include "LineIndex.h"
+#include <mutex>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* A text being parsed. The Parser and the tokens read from it share it, so
+  tokens can give their line and column (see Token::GetPosition()) for as
+  long as they are kept. The line index is built on the first lookups and
+  is guarded by a lock, so the tokens of one text can be asked from several
+  threads. */
+  class SourceText
+  {
+  private:
+    GPSTR_T Own_;
+    const GPSTR_T *Text_;         // Own_, or the text of the caller, see Refer()
+    mutable std::mutex Mutex_;
+    mutable LineIndex Lines_;     // Guarded by Mutex_
+
+#ifndef __GNUC__
+    SourceText(const SourceText& that){}
+#else
+    SourceText(const SourceText& that) = delete;
+#endif
+
+  public:
+
+    explicit SourceText(const GPSTR_T &text);
+
+    /* Replaces the text. Tokens already read from it then refer to the new
+    text, as the reused parts of a tree do after an incremental parse (see
+    Parser::Open()). Must not be called while positions are looked up. */
+    void Assign(const GPSTR_T &text);
+
+    /* Replaces the text with 'text' itself, without copying it. The caller
+    must keep it as it is for as long as it is lexed or parsed, and positions
+    are looked up in it. Must not be called while positions are looked up. */
+    void Refer(const GPSTR_T &text);
+
+    const GPSTR_T& GetText() const
+    {
+      return *Text_;
+    }
+
+    /* Line and column of a character offset in the text. */
+    Position GetPosition(size_t offset) const;
+  };
+}
+
+#endif // GOLDCPP_SOURCETEXT_H
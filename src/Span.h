@@ -0,0 +1,36 @@
+#ifndef GOLDCPP_SPAN_H
+#define GOLDCPP_SPAN_H
+
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* A range of characters [Begin, End) in the parsed source.
+  Offsets count GPCHR_T characters, not bytes. */
+  struct Span
+  {
+    size_t Begin;
+    size_t End;
+
+    Span()
+      : Begin(0), End(0)
+    {}
+
+    Span(size_t begin, size_t end)
+      : Begin(begin), End(end)
+    {}
+
+    size_t Length() const
+    {
+      return End - Begin;
+    }
+
+    /* The same length of text, 'by' characters further on (or back, if negative). */
+    Span Shifted(ptrdiff_t by) const
+    {
+      return Span(Begin + by, End + by);
+    }
+  };
+}
+
+#endif // GOLDCPP_SPAN_H
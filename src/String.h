@@ -4,14 +4,49 @@
 #include <string>
 
 #ifndef __GNUC__
-  #define GPSTR_T       std::string
   #define GPSTR_C(str)  str
   #define GPCHR_T       char
 #else
-  #define GPSTR_T       std::u16string
   #define GPSTR_C(str)  u##str
   #define GPCHR_T       char16_t
 #endif
 
-#endif // GOLDCPP_STRING_H
+#ifndef GOLDCPP_SHARED_TABLES
+  #ifndef __GNUC__
+    #define GPSTR_T     std::string
+  #else
+    #define GPSTR_T     std::u16string
+  #endif
+#else
+  #include "TableAllocator.h"
+  #include <functional>
+
+  namespace GoldCPP
+  {
+    // Strings of the tables must be allocated like the tables, see TableAllocator
+    typedef std::basic_string<GPCHR_T, std::char_traits<GPCHR_T>, TableAllocator<GPCHR_T>> TableString;
+  }
+
+  #define GPSTR_T       GoldCPP::TableString
 
+  namespace std
+  {
+    template <>
+    struct hash<GoldCPP::TableString>
+    {
+      size_t operator()(const GoldCPP::TableString &str) const
+      {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < str.size(); ++i)
+        {
+          h ^= (uint64_t)str[i];
+          h *= 1099511628211ull;
+        }
+        return (size_t)h;
+      }
+    };
+  }
+#endif
+
+#endif // GOLDCPP_STRING_H
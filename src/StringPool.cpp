@@ -0,0 +1,41 @@
+#include "StringPool.h"
+#include "MemoryUsage.h"
+
+namespace GoldCPP
+{
+  const GPSTR_T& StringPool::Intern(const GPSTR_T &str)
+  {
+    IndexMap::const_iterator it = Index_.find(str);
+    if (it != Index_.end())
+      return *(it->second);
+
+    Strings_.push_back(str);
+    const GPSTR_T *pooled = &Strings_.back();
+    Index_[str] = pooled;
+    return *pooled;
+  }
+
+  void StringPool::Clear()
+  {
+    Index_.clear();
+    Strings_.clear();
+  }
+
+  size_t StringPool::HeapBytes() const
+  {
+    // Deques allocate blocks of 512 bytes (or one item, if larger) and an array of pointers to them
+    const size_t blockSize = (sizeof(GPSTR_T) < 512) ? 512 : sizeof(GPSTR_T);
+    size_t blocks = Strings_.size() / (blockSize / sizeof(GPSTR_T)) + 1;
+    size_t bytes = blocks * blockSize + (blocks + 8) * sizeof(void*);
+
+    // Hash map nodes hold the item, a link and the cached hash
+    typedef IndexMap::value_type Item;
+    bytes += Index_.size() * (sizeof(Item) + 2 * sizeof(void*)) + Index_.bucket_count() * sizeof(void*);
+
+    // Both copies of each string
+    for (size_t i = 0; i < Strings_.size(); ++i)
+      bytes += 2 * GoldCPP::HeapBytes(Strings_[i]);
+
+    return bytes;
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef GOLDCPP_STRINGPOOL_H
+#define GOLDCPP_STRINGPOOL_H
+
+#include "String.h"
+#include "TableAllocator.h"
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Keeps one copy of each distinct string added to it. References to the
+  strings stay valid until the pool is cleared or destroyed. */
+  class StringPool
+  {
+  private:
+    typedef std::unordered_map<GPSTR_T, const GPSTR_T*, std::hash<GPSTR_T>, std::equal_to<GPSTR_T>,
+      TableAllocator<std::pair<const GPSTR_T, const GPSTR_T*>>> IndexMap;
+
+    std::deque<GPSTR_T, TableAllocator<GPSTR_T>> Strings_;
+    IndexMap Index_;
+
+#ifndef __GNUC__
+    StringPool(const StringPool& that){}
+#else
+    StringPool(const StringPool& that) = delete;
+#endif
+
+  public:
+
+    StringPool()
+    {}
+
+    /* Returns the pooled copy of 'str', adding it if needed. */
+    const GPSTR_T& Intern(const GPSTR_T &str);
+
+    void Clear();
+
+    size_t Count() const
+    {
+      return Strings_.size();
+    }
+
+    /* Heap memory held by the pool. The deque and hash map are estimated
+    from the usual layout of their nodes. */
+    size_t HeapBytes() const;
+  };
+}
+
+#endif // GOLDCPP_STRINGPOOL_H
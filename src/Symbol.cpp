@@ -25,7 +25,24 @@ namespace GoldCPP
     }
   }
 
-  GPSTR_T Symbol::GetText(bool AlwaysDelimitTerminals) const
+  const GPSTR_T& Symbol::GetText(bool AlwaysDelimitTerminals) const
+  {
+    const GPSTR_T *text = AlwaysDelimitTerminals ? DelimitedText_ : Text_;
+    if (text)
+      return *text;
+
+    return AlwaysDelimitTerminals ? OwnDelimitedText_ : OwnText_;
+  }
+
+  void Symbol::RenderText(StringPool &pool)
+  {
+    Text_ = &pool.Intern(BuildText(false));
+    DelimitedText_ = &pool.Intern(BuildText(true));
+    GPSTR_T().swap(OwnText_);
+    GPSTR_T().swap(OwnDelimitedText_);
+  }
+
+  GPSTR_T Symbol::BuildText(bool AlwaysDelimitTerminals) const
   {
     switch (Type)
     {
@@ -38,7 +55,7 @@ namespace GoldCPP
     }
   }
 
-  GPSTR_T Symbol::GetText() const
+  const GPSTR_T& Symbol::GetText() const
   {
     return GetText(false);
   }
@@ -50,7 +67,7 @@ namespace GoldCPP
   */
 
 
-  Symbol* SymbolList::GetFirstOfType(Symbol::SymbolType type)
+  const Symbol* SymbolList::GetFirstOfType(Symbol::SymbolType type) const
   {
     size_t numItems = Count();
     for (size_t i = 0; i < numItems; ++i)
@@ -83,4 +100,26 @@ namespace GoldCPP
     return GetText(GPSTR_C(", "), false);
   }
 
+
+  /* ----------------------------------------
+                 SymbolIdSpan
+     ----------------------------------------
+  */
+
+
+  GPSTR_T SymbolIdSpan::GetText(const GPSTR_T &separator, bool AlwaysDelimitTerminals) const
+  {
+    GPSTR_T result;
+
+    if (Count_ == 0)
+      return result;
+
+    result = (*this)[0].GetText(AlwaysDelimitTerminals);
+
+    for (size_t i = 1; i < Count_; ++i)
+      result += separator + (*this)[i].GetText(AlwaysDelimitTerminals);
+
+    return result;
+  }
+
 }
@@ -3,7 +3,9 @@
 
 #include "String.h"
 #include "Vector.h"
+#include "StringPool.h"
 #include <cstdint>
+#include <cassert>
 
 namespace GoldCPP
 {
@@ -28,18 +30,60 @@ namespace GoldCPP
     SymbolType Type;
     uint32_t TableIndex;
 
-    GPSTR_T GetText(bool AlwaysDelimitTerminals) const;
-    GPSTR_T GetText() const;
+    /* Display text, such as <Name> for nonterminals. Rendered once by
+    RenderText() when the tables are loaded, so it can be returned by reference.
+    Symbols that were not rendered, such as copies of those in the tables,
+    keep both texts in strings of their own, built when they are constructed
+    or copied, so they do not depend on the tables. A symbol changed after
+    that keeps the texts it had. */
+    const GPSTR_T& GetText(bool AlwaysDelimitTerminals) const;
+    const GPSTR_T& GetText() const;
+
+    /* Renders the display texts into 'pool'. */
+    void RenderText(StringPool &pool);
+
+    /* Builds the display text anew. */
+    GPSTR_T BuildText(bool AlwaysDelimitTerminals) const;
 
     Symbol()
-      : GoldGroup(NULL), Name(), Type(SymbolType::Nonterminal), TableIndex(0)
+      : GoldGroup(NULL), Name(), Type(SymbolType::Nonterminal), TableIndex(0), Text_(), DelimitedText_(),
+        OwnText_(BuildText(false)), OwnDelimitedText_(BuildText(true))
     {}
 
     Symbol(const GPSTR_T &name, SymbolType type, uint32_t tindex)
-      : GoldGroup(NULL), Name(name), Type(type), TableIndex(tindex)
+      : GoldGroup(NULL), Name(name), Type(type), TableIndex(tindex), Text_(), DelimitedText_(),
+        OwnText_(BuildText(false)), OwnDelimitedText_(BuildText(true))
+    {}
+
+    // Copies are not rendered, as the texts belong to the tables
+    Symbol(const Symbol &that)
+      : GoldGroup(that.GoldGroup), Name(that.Name), Type(that.Type), TableIndex(that.TableIndex), Text_(), DelimitedText_(),
+        OwnText_(that.GetText(false)), OwnDelimitedText_(that.GetText(true))
     {}
 
+    Symbol& operator= (const Symbol &that)
+    {
+      if (this != &that)
+      {
+        GoldGroup = that.GoldGroup;
+        Name = that.Name;
+        Type = that.Type;
+        TableIndex = that.TableIndex;
+        OwnText_ = that.GetText(false);
+        OwnDelimitedText_ = that.GetText(true);
+        Text_ = NULL;
+        DelimitedText_ = NULL;
+      }
+      return *this;
+    }
+
     GPSTR_T getLiteralFormat(const GPSTR_T source, bool ForceDelimit) const;
+
+  private:
+    const GPSTR_T *Text_;
+    const GPSTR_T *DelimitedText_;    // With AlwaysDelimitTerminals
+    GPSTR_T OwnText_;                 // Used if not rendered
+    GPSTR_T OwnDelimitedText_;
   };
 
 
@@ -47,7 +91,7 @@ namespace GoldCPP
   {
   public:
 
-    Symbol* GetFirstOfType(Symbol::SymbolType type);
+    const Symbol* GetFirstOfType(Symbol::SymbolType type) const;
     GPSTR_T GetText(const GPSTR_T &separator, bool AlwaysDelimitTerminals) const;
     GPSTR_T GetText() const;
 
@@ -57,6 +101,55 @@ namespace GoldCPP
 
   };
 
+  /* A read-only view of symbol ids (Symbol::TableIndex) stored in the parser
+  tables, such as the handle of a Production. Indexing gives the Symbols
+  themselves, so it can be used much like a SymbolList, without copying. */
+  class SymbolIdSpan
+  {
+  private:
+    const uint16_t *Ids_;
+    size_t Count_;
+    const SymbolList *Symbols_;
+
+  public:
+
+    SymbolIdSpan() :
+      Ids_(NULL), Count_(0), Symbols_(NULL)
+    {}
+
+    SymbolIdSpan(const uint16_t *ids, size_t count, const SymbolList *symbols) :
+      Ids_(ids), Count_(count), Symbols_(symbols)
+    {}
+
+    size_t Count() const
+    {
+      return Count_;
+    }
+
+    uint16_t GetId(size_t index) const
+    {
+      assert(index < Count_);
+      return Ids_[index];
+    }
+
+    const Symbol& operator[] (size_t index) const
+    {
+      return (*Symbols_)[GetId(index)];
+    }
+
+    const uint16_t* begin() const
+    {
+      return Ids_;
+    }
+
+    const uint16_t* end() const
+    {
+      return Ids_ + Count_;
+    }
+
+    GPSTR_T GetText(const GPSTR_T &separator, bool AlwaysDelimitTerminals) const;
+  };
+
 }
 
 #endif // GOLDCPP_SYMBOL_H
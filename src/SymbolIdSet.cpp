@@ -0,0 +1,53 @@
+#include "SymbolIdSet.h"
+
+namespace GoldCPP
+{
+  void SymbolIdSet::Add(uint32_t id)
+  {
+    size_t word = id / 64;
+    if (word >= Bits_.size())
+      Bits_.resize(word + 1, 0);
+
+    Bits_[word] |= (uint64_t)1 << (id % 64);
+  }
+
+  bool SymbolIdSet::Contains(uint32_t id) const
+  {
+    size_t word = id / 64;
+    return (word < Bits_.size()) && ((Bits_[word] >> (id % 64)) & 1);
+  }
+
+  size_t SymbolIdSet::Count() const
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < Bits_.size(); ++i)
+    {
+      for (uint64_t bits = Bits_[i]; bits != 0; bits &= bits - 1)
+        ++count;
+    }
+
+    return count;
+  }
+
+  uint32_t SymbolIdSet::Next(uint32_t from) const
+  {
+    size_t word = from / 64;
+    if (word >= Bits_.size())
+      return End();
+
+    // Bits below 'from' in its word are masked off
+    uint64_t bits = Bits_[word] & (~(uint64_t)0 << (from % 64));
+    while (bits == 0)
+    {
+      if (++word == Bits_.size())
+        return End();
+      bits = Bits_[word];
+    }
+
+    uint32_t bit = 0;
+    while (!((bits >> bit) & 1))
+      ++bit;
+
+    return (uint32_t)(word * 64 + bit);
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef GOLDCPP_SYMBOLIDSET_H
+#define GOLDCPP_SYMBOLIDSET_H
+
+#include "TableAllocator.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* A set of symbols as a bitset over their Symbol::TableIndex.
+  Iterating yields the indices in increasing order. */
+  class SymbolIdSet
+  {
+  private:
+    TableVector<uint64_t> Bits_;
+
+  public:
+
+    class Iterator
+    {
+    private:
+      const SymbolIdSet *Set_;
+      uint32_t Id_;
+
+    public:
+      Iterator(const SymbolIdSet *set, uint32_t id) :
+        Set_(set), Id_(id)
+      {}
+
+      uint32_t operator*() const
+      {
+        return Id_;
+      }
+
+      Iterator& operator++()
+      {
+        Id_ = Set_->Next(Id_ + 1);
+        return *this;
+      }
+
+      bool operator==(const Iterator &other) const
+      {
+        return Id_ == other.Id_;
+      }
+
+      bool operator!=(const Iterator &other) const
+      {
+        return Id_ != other.Id_;
+      }
+    };
+
+    void Add(uint32_t id);
+    bool Contains(uint32_t id) const;
+    size_t Count() const;
+
+    bool Empty() const
+    {
+      return Count() == 0;
+    }
+
+    void Clear()
+    {
+      Bits_.clear();
+    }
+
+    size_t HeapBytes() const
+    {
+      return Bits_.capacity() * sizeof(uint64_t);
+    }
+
+    /* The smallest id in the set that is at least 'from', or End(). */
+    uint32_t Next(uint32_t from) const;
+
+    /* Past the largest id that can be in the set. */
+    uint32_t End() const
+    {
+      return (uint32_t)(Bits_.size() * 64);
+    }
+
+    Iterator begin() const
+    {
+      return Iterator(this, Next(0));
+    }
+
+    Iterator end() const
+    {
+      return Iterator(this, End());
+    }
+  };
+}
+
+#endif // GOLDCPP_SYMBOLIDSET_H
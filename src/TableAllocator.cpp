@@ -0,0 +1,52 @@
+#include "TableAllocator.h"
+#include <functional>
+
+#ifdef GOLDCPP_SHARED_TABLES
+
+namespace GoldCPP
+{
+  static thread_local TableArena *CurrentArena = NULL;
+
+  TableArena::TableArena(void *begin, size_t length) :
+    Begin_((uint8_t*)begin), Next_((uint8_t*)begin), End_((uint8_t*)begin + length), Overflowed_(false)
+  {
+  }
+
+  void* TableArena::Allocate(size_t bytes)
+  {
+    const size_t align = alignof(std::max_align_t);
+    size_t offset = (Used() + align - 1) & ~(align - 1);
+    if ((bytes > (size_t)(End_ - Begin_)) || (offset > (size_t)(End_ - Begin_) - bytes))
+    {
+      Overflowed_ = true;
+      return NULL;
+    }
+
+    Next_ = Begin_ + offset + bytes;
+    return Begin_ + offset;
+  }
+
+  bool TableArena::Contains(const void *p) const
+  {
+    std::less<const void*> before;
+    return !before(p, Begin_) && before(p, End_);
+  }
+
+  TableArena* TableArena::Current()
+  {
+    return CurrentArena;
+  }
+
+  TableArena::Scope::Scope(TableArena *arena) :
+    Previous_(CurrentArena)
+  {
+    CurrentArena = arena;
+  }
+
+  TableArena::Scope::~Scope()
+  {
+    CurrentArena = Previous_;
+  }
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef GOLDCPP_TABLEALLOCATOR_H
+#define GOLDCPP_TABLEALLOCATOR_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+#ifdef GOLDCPP_SHARED_TABLES
+  /* Memory that tables are built in, so that they can be mapped into other
+  processes at the same address and used there as they are (see
+  SharedTables.h). Allocation moves a pointer forward, and nothing is
+  freed; blocks the tables let go of while loading stay unused. */
+  class TableArena
+  {
+  private:
+    uint8_t *Begin_;
+    uint8_t *Next_;
+    uint8_t *End_;
+    bool Overflowed_;
+
+#ifndef __GNUC__
+    TableArena(const TableArena& that){}
+#else
+    TableArena(const TableArena& that) = delete;
+#endif
+
+  public:
+
+    TableArena(void *begin, size_t length);
+
+    /* NULL if the arena is full, which Overflowed() reports from then on. */
+    void* Allocate(size_t bytes);
+
+    bool Contains(const void *p) const;
+
+    bool Overflowed() const
+    {
+      return Overflowed_;
+    }
+
+    /* Bytes allocated so far. */
+    size_t Used() const
+    {
+      return (size_t)(Next_ - Begin_);
+    }
+
+    /* The arena that table containers allocate from on this thread, or
+    NULL for the heap. */
+    static TableArena* Current();
+
+    /* Makes an arena current on this thread for as long as it exists. */
+    class Scope
+    {
+    private:
+      TableArena *Previous_;
+
+#ifndef __GNUC__
+      Scope(const Scope& that){}
+#else
+      Scope(const Scope& that) = delete;
+#endif
+
+    public:
+      explicit Scope(TableArena *arena);
+      ~Scope();
+    };
+  };
+
+  /* Allocates from the current TableArena if there is one, and from the
+  heap otherwise. Blocks in an arena are never freed one by one. If the
+  arena is full, the heap is used, and the arena reports the overflow. */
+  template <typename T>
+  class TableAllocator
+  {
+  public:
+    typedef T value_type;
+
+    TableAllocator()
+    {}
+
+    template <typename U>
+    TableAllocator(const TableAllocator<U> &)
+    {}
+
+    T* allocate(size_t n)
+    {
+      TableArena *arena = TableArena::Current();
+      void *block = arena ? arena->Allocate(n * sizeof(T)) : NULL;
+      return static_cast<T*>(block ? block : ::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+      TableArena *arena = TableArena::Current();
+      if (!arena || !arena->Contains(p))
+        ::operator delete(p);
+    }
+  };
+
+  template <typename T, typename U>
+  bool operator== (const TableAllocator<T> &, const TableAllocator<U> &)
+  {
+    return true;
+  }
+
+  template <typename T, typename U>
+  bool operator!= (const TableAllocator<T> &, const TableAllocator<U> &)
+  {
+    return false;
+  }
+#else
+  template <typename T>
+  using TableAllocator = std::allocator<T>;
+#endif
+
+  /* Storage of the tables. The same as std::vector, unless GOLDCPP_SHARED_TABLES
+  is defined. */
+  template <typename T>
+  using TableVector = std::vector<T, TableAllocator<T>>;
+}
+
+#endif // GOLDCPP_TABLEALLOCATOR_H
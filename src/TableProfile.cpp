@@ -0,0 +1,152 @@
+#include "TableProfile.h"
+#include "Symbol.h"
+#include "CharacterSet.h"
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace GoldCPP
+{
+  static const char *kHeader = "GoldCPP table profile 1";
+
+  static void HashIn(uint64_t &h, uint64_t value)
+  {
+    // FNV-1a over the bytes of 'value'
+    for (size_t i = 0; i < sizeof(value); ++i)
+    {
+      h ^= (value >> (i * 8)) & 0xFF;
+      h *= 1099511628211ull;
+    }
+  }
+
+  void TableProfile::Clear()
+  {
+    Fingerprint = 0;
+    DfaStates.clear();
+    DfaEdges.clear();
+    LRStates.clear();
+    LRActions.clear();
+  }
+
+  void TableProfile::Reset(const FaStateList &dfa, const LRStateList &lalr)
+  {
+    Fingerprint = GetFingerprint(dfa, lalr);
+
+    DfaStates.assign(dfa.Count(), 0);
+    DfaEdges.resize(dfa.Count());
+    for (size_t i = 0; i < dfa.Count(); ++i)
+      DfaEdges[i].assign(dfa[i].Edges.Count(), 0);
+
+    LRStates.assign(lalr.Count(), 0);
+    LRActions.resize(lalr.Count());
+    for (size_t i = 0; i < lalr.Count(); ++i)
+      LRActions[i].assign(lalr[i].Actions.Count(), 0);
+  }
+
+  uint64_t TableProfile::GetFingerprint(const FaStateList &dfa, const LRStateList &lalr)
+  {
+    uint64_t h = 14695981039346656037ull;
+
+    HashIn(h, dfa.Count());
+    HashIn(h, dfa.InitialState);
+    for (size_t i = 0; i < dfa.Count(); ++i)
+    {
+      const FaState &state = dfa[i];
+      HashIn(h, state.Accept ? state.Accept->TableIndex : (uint64_t)-1);
+      HashIn(h, state.Edges.Count());
+      for (size_t n = 0; n < state.Edges.Count(); ++n)
+      {
+        const CharacterSet &chars = *(state.Edges[n].Characters);
+        HashIn(h, state.Edges[n].Target);
+        HashIn(h, chars.Count());
+        for (size_t r = 0; r < chars.Count(); ++r)
+        {
+          HashIn(h, chars[r].Start);
+          HashIn(h, chars[r].End);
+        }
+      }
+    }
+
+    HashIn(h, lalr.Count());
+    HashIn(h, lalr.InitialState);
+    for (size_t i = 0; i < lalr.Count(); ++i)
+    {
+      const Vector<LRAction> &actions = lalr[i].Actions;
+      HashIn(h, actions.Count());
+      for (size_t n = 0; n < actions.Count(); ++n)
+      {
+        HashIn(h, actions[n].Sym->TableIndex);
+        HashIn(h, (uint64_t)actions[n].Type);
+        HashIn(h, actions[n].Value);
+      }
+    }
+
+    return h;
+  }
+
+  static void SaveCounts(std::ostream &out, const std::vector<uint64_t> &states, const std::vector<std::vector<uint64_t>> &items)
+  {
+    out << states.size() << '\n';
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+      out << states[i] << ' ' << items[i].size();
+      for (size_t n = 0; n < items[i].size(); ++n)
+        out << ' ' << items[i][n];
+      out << '\n';
+    }
+  }
+
+  static bool LoadCounts(std::istream &in, const char *name, std::vector<uint64_t> &states, std::vector<std::vector<uint64_t>> &items)
+  {
+    std::string tag;
+    size_t count = 0;
+    if (!(in >> tag >> count) || (tag != name))
+      return false;
+
+    states.assign(count, 0);
+    items.assign(count, std::vector<uint64_t>());
+    for (size_t i = 0; i < count; ++i)
+    {
+      size_t numItems = 0;
+      if (!(in >> states[i] >> numItems))
+        return false;
+
+      items[i].assign(numItems, 0);
+      for (size_t n = 0; n < numItems; ++n)
+      {
+        if (!(in >> items[i][n]))
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool TableProfile::Save(std::ostream &out) const
+  {
+    out << kHeader << '\n' << std::hex << Fingerprint << std::dec << '\n';
+    out << "dfa ";
+    SaveCounts(out, DfaStates, DfaEdges);
+    out << "lalr ";
+    SaveCounts(out, LRStates, LRActions);
+    return !out.fail();
+  }
+
+  bool TableProfile::Load(std::istream &in)
+  {
+    Clear();
+
+    std::string header;
+    std::getline(in, header);
+    if ((header != kHeader) || !(in >> std::hex >> Fingerprint >> std::dec))
+      return false;
+
+    if (!LoadCounts(in, "dfa", DfaStates, DfaEdges) || !LoadCounts(in, "lalr", LRStates, LRActions))
+    {
+      Clear();
+      return false;
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef GOLDCPP_TABLEPROFILE_H
+#define GOLDCPP_TABLEPROFILE_H
+
+#include "FaState.h"
+#include "LrState.h"
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+
+namespace GoldCPP
+{
+  /* How often each DFA state and edge and each LALR state and action was
+  used while parsing sample input, see Parser::RecordProfile(). Counts are
+  indexed like the tables they were recorded on, which the Fingerprint
+  identifies. */
+  class TableProfile
+  {
+  public:
+
+    uint64_t Fingerprint;
+    std::vector<uint64_t> DfaStates;
+    std::vector<std::vector<uint64_t>> DfaEdges;      // Per state, indexed like FaState::Edges
+    std::vector<uint64_t> LRStates;
+    std::vector<std::vector<uint64_t>> LRActions;     // Per state, indexed like LRState::Actions
+
+    TableProfile() :
+      Fingerprint(0)
+    {}
+
+    void Clear();
+
+    /* Sets all counts to 0 for the given tables. */
+    void Reset(const FaStateList &dfa, const LRStateList &lalr);
+
+    /* Writes the profile as text, so it can be recorded once and read back
+    whenever the tables are loaded. */
+    bool Save(std::ostream &out) const;
+
+    /* Reads a profile written by Save(). Returns false and leaves the profile
+    empty if the input is not one. */
+    bool Load(std::istream &in);
+
+    /* Identifies the layout of the tables: any change to their states,
+    edges or actions, including their order, gives another value. */
+    static uint64_t GetFingerprint(const FaStateList &dfa, const LRStateList &lalr);
+  };
+}
+
+#endif // GOLDCPP_TABLEPROFILE_H
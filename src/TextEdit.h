@@ -0,0 +1,26 @@
+#ifndef GOLDCPP_TEXTEDIT_H
+#define GOLDCPP_TEXTEDIT_H
+
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Describes a change to a text: 'Removed' characters starting at 'Offset'
+  were replaced by 'Inserted' characters. Offsets count GPCHR_T characters. */
+  struct TextEdit
+  {
+    size_t Offset;
+    size_t Removed;
+    size_t Inserted;
+
+    TextEdit()
+      : Offset(0), Removed(0), Inserted(0)
+    {}
+
+    TextEdit(size_t offset, size_t removed, size_t inserted)
+      : Offset(offset), Removed(removed), Inserted(inserted)
+    {}
+  };
+}
+
+#endif // GOLDCPP_TEXTEDIT_H
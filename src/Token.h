@@ -2,12 +2,13 @@
 #define GOLDCPP_TOKEN_H
 
 #include "Symbol.h"
+#include "Span.h"
+#include "SourceText.h"
 #include "Position.h"
 #include "Vector.h"
 #include "String.h"
 #include <cstdint>
-#include <stack>
-#include <list>
+#include <deque>
 #include <memory>
 
 namespace GoldCPP
@@ -22,20 +23,29 @@ namespace GoldCPP
 
   struct Token
   {
-    Symbol* Parent;
+    const Symbol* Parent;
     std::shared_ptr<Reduction> ReductionData;
     GPSTR_T StringData;
     uint16_t State;
-    Position Pos;
+    Span Location;      // Source text covered by the token, see Parser::GetSource() and Reduction::GetShift()
+    std::shared_ptr<SourceText> Source;     // Text the token was read from, NULL if not read by a Parser
 
     Token() :
-      Parent(NULL), ReductionData(NULL), State(0)
+      Parent(NULL), ReductionData(NULL), State(0), Location()
     {}
 
-    Token(Symbol *parent, const std::shared_ptr<Reduction> &data) :
-      Parent(parent), ReductionData(data), State(0)
+    Token(const Symbol *parent, const std::shared_ptr<Reduction> &data) :
+      Parent(parent), ReductionData(data), State(0), Location()
     {}
 
+    /* Line and column where the token starts. Looked up in Source when
+    asked for, see SourceText::GetPosition(). For a branch of a tree, pass
+    the shift of its place in the tree, see Reduction::GetShift(). */
+    Position GetPosition(ptrdiff_t shift = 0) const
+    {
+      return Source ? Source->GetPosition(Location.Begin + shift) : Position();
+    }
+
     Symbol::SymbolType GetType() const
     {
       return Parent->Type;
@@ -48,12 +58,11 @@ namespace GoldCPP
   };
 
   typedef Vector<std::shared_ptr<Token>> TokenList;
-  typedef std::stack<std::shared_ptr<Token>> TokenStack;
 
   class TokenQueueStack   // Hybrid stack and queue
   {
   private:
-    std::list<std::shared_ptr<Token>>  list_;
+    std::deque<std::shared_ptr<Token>>  list_;
 
   public:
 
@@ -97,6 +106,12 @@ namespace GoldCPP
         return NULL;
     }
 
+    /* Token at 'index' counted from the top, which must be less than Count(). */
+    const std::shared_ptr<Token>& Peek(size_t index) const
+    {
+      return list_[index];
+    }
+
   };
 
 }
@@ -0,0 +1,58 @@
+#include "TokenStack.h"
+
+namespace GoldCPP
+{
+  TokenStack::Segment::~Segment()
+  {
+    // Free the segments below one by one, deep stacks would overflow the call stack otherwise
+    std::shared_ptr<Segment> below = std::move(Below);
+    while (below && (below.use_count() == 1))
+    {
+      std::shared_ptr<Segment> next = std::move(below->Below);
+      below = std::move(next);
+    }
+  }
+
+  void TokenStack::push(const std::shared_ptr<Token> &token)
+  {
+    if (!Top_ || (TopCount_ == kSegmentSize))
+    {
+      std::shared_ptr<Segment> seg = std::make_shared<Segment>();
+      seg->Below = Top_;
+      Top_ = seg;
+      TopCount_ = 0;
+    }
+    else if (Top_.use_count() > 1)
+    {
+      // Shared with a copy, take our part of it
+      std::shared_ptr<Segment> seg = std::make_shared<Segment>();
+      seg->Items.assign(Top_->Items.begin(), Top_->Items.begin() + TopCount_);
+      seg->Below = Top_->Below;
+      Top_ = seg;
+    }
+    else
+    {
+      Top_->Items.resize(TopCount_);    // Drop items left by copies that are gone now
+    }
+
+    Top_->Items.push_back(token);
+    ++TopCount_;
+    ++Size_;
+  }
+
+  void TokenStack::pop()
+  {
+    if (Top_.use_count() == 1)
+      Top_->Items.resize(TopCount_ - 1);
+
+    --TopCount_;
+    --Size_;
+
+    if (TopCount_ == 0)
+    {
+      std::shared_ptr<Segment> below = Top_->Below;
+      Top_ = below;
+      TopCount_ = Top_ ? kSegmentSize : 0;
+    }
+  }
+}
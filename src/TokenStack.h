@@ -0,0 +1,65 @@
+#ifndef GOLDCPP_TOKENSTACK_H
+#define GOLDCPP_TOKENSTACK_H
+
+#include "Token.h"
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* A stack of tokens that can be copied in constant time, used like
+  std::stack. The items are kept in fixed size segments, each linked to the
+  full segment below it. Copies share their segments, and a shared segment
+  is copied (at most kSegmentSize items) before it is pushed onto.
+
+  Only the stack itself is copied, not the tokens on it. */
+  class TokenStack
+  {
+  private:
+    static const size_t kSegmentSize = 32;
+
+    struct Segment
+    {
+      std::vector<std::shared_ptr<Token>> Items;
+      std::shared_ptr<Segment> Below;     // Always full
+
+      Segment()
+      {
+        Items.reserve(kSegmentSize);
+      }
+
+      ~Segment();
+    };
+
+    std::shared_ptr<Segment> Top_;
+    size_t TopCount_;     // Items of Top_ that belong to this stack, Top_ may hold more if shared
+    size_t Size_;
+
+  public:
+
+    TokenStack() :
+      TopCount_(0), Size_(0)
+    {}
+
+    bool empty() const
+    {
+      return Size_ == 0;
+    }
+
+    size_t size() const
+    {
+      return Size_;
+    }
+
+    const std::shared_ptr<Token>& top() const
+    {
+      return Top_->Items[TopCount_ - 1];
+    }
+
+    void push(const std::shared_ptr<Token> &token);
+    void pop();
+  };
+}
+
+#endif // GOLDCPP_TOKENSTACK_H
@@ -0,0 +1,265 @@
+#include "TraceRecorder.h"
+#include <istream>
+#include <ostream>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#ifdef __GNUC__
+  #include "utf8/checked.h"
+#endif
+
+namespace GoldCPP
+{
+  static const char kMagic[4] = { 'G', 'C', 'T', 'R' };
+  static const uint32_t kVersion = 1;
+
+  TraceRecorder::TraceRecorder(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity)
+      size *= 2;
+
+    Events_.resize(size);
+    Mask_ = size - 1;
+    Clear();
+  }
+
+  void TraceRecorder::Clear()
+  {
+    Next_ = 0;
+    DroppedBefore_ = 0;
+    StartTicks_ = Now();
+    StartTime_ = std::chrono::steady_clock::now();
+    InNanoseconds_ = false;
+  }
+
+  size_t TraceRecorder::Count() const
+  {
+    return (Next_ < Events_.size()) ? (size_t)Next_ : Events_.size();
+  }
+
+  uint64_t TraceRecorder::Dropped() const
+  {
+    return DroppedBefore_ + (Next_ - Count());
+  }
+
+  double TraceRecorder::NanosecondsPerTick() const
+  {
+#ifdef GOLDCPP_TRACE_TSC
+    /* The TSC rate is not known up front. Compare it to the clock over the
+    whole time since Clear(), which is long enough to be accurate when
+    there is anything worth looking at. */
+    uint64_t ticks = Now() - StartTicks_;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime_).count();
+    return (ticks > 0) ? ns / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+  }
+
+  void TraceRecorder::GetEvents(std::vector<TraceEvent> &out) const
+  {
+    size_t count = Count();
+    out.resize(count);
+    if (count == 0)
+      return;
+
+    double scale = InNanoseconds_ ? 1.0 : NanosecondsPerTick();
+    uint64_t first = (uint64_t)(Next_ - count);
+    uint64_t base = Events_[(size_t)first & Mask_].Time;
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i] = Events_[(size_t)(first + i) & Mask_];
+      out[i].Time = (uint64_t)((out[i].Time - base) * scale);
+    }
+  }
+
+  static std::string ToUtf8(const GPSTR_T &text)
+  {
+#ifdef __GNUC__
+    std::string result;
+    utf8::utf16to8(text.begin(), text.end(), std::back_inserter(result));
+    return result;
+#else
+    return text;
+#endif
+  }
+
+  static void WriteJsonString(std::ostream &out, const std::string &text)
+  {
+    out << '"';
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+      unsigned char c = (unsigned char)text[i];
+      if ((c == '"') || (c == '\\'))
+        out << '\\' << (char)c;
+      else if (c < 0x20)
+      {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        out << escaped;
+      }
+      else
+        out << (char)c;
+    }
+    out << '"';
+  }
+
+  bool TraceRecorder::SaveChromeTrace(std::ostream &out, const SymbolList *symbols, const ProductionList *productions) const
+  {
+    static const char *kErrors[] = {
+      "TokenRead", "Reduction", "Accept", "NotLoadedError", "LexicalError", "SyntaxError", "GroupError", "InternalError"
+    };
+
+    std::vector<TraceEvent> events;
+    GetEvents(events);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+      const TraceEvent &event = events[i];
+      const char *name = "";
+      const char *category = "parser";
+      const char *phase = "i";
+      const char *argName = "symbol";
+      std::string arg;
+
+      switch (event.Type)
+      {
+      case TraceEventType::Token:
+        name = "Token";
+        category = "lexer";
+        break;
+      case TraceEventType::Shift:
+        name = "Shift";
+        break;
+      case TraceEventType::Reduce:
+        name = "Reduce";
+        argName = "production";
+        if (productions && (event.Value < productions->Count()))
+          arg = ToUtf8((*productions)[event.Value].GetText());
+        break;
+      case TraceEventType::GroupPush:
+      case TraceEventType::GroupPop:
+        name = "Group";
+        category = "lexer";
+        phase = (event.Type == TraceEventType::GroupPush) ? "B" : "E";
+        break;
+      case TraceEventType::Error:
+        name = (event.Value < sizeof(kErrors) / sizeof(kErrors[0])) ? kErrors[event.Value] : "Error";
+        argName = NULL;
+        break;
+      }
+
+      if (argName && arg.empty())
+      {
+        if (symbols && (argName[0] == 's') && (event.Value < symbols->Count()))
+          arg = ToUtf8((*symbols)[event.Value].GetText());
+        else
+          arg = std::to_string(event.Value);
+      }
+
+      char time[32];
+      std::snprintf(time, sizeof(time), "%.3f", event.Time / 1000.0);    // Microseconds
+
+      out << ((i > 0) ? ",\n" : "\n") << "{\"name\":\"" << name << "\",\"cat\":\"" << category
+          << "\",\"ph\":\"" << phase << "\",\"ts\":" << time << ",\"pid\":1,\"tid\":1";
+      if (phase[0] == 'i')
+        out << ",\"s\":\"" << ((event.Type == TraceEventType::Error) ? 'g' : 't') << '"';
+      out << ",\"args\":{\"offset\":" << event.Offset;
+      if (argName)
+      {
+        out << ",\"" << argName << "\":";
+        WriteJsonString(out, arg);
+      }
+      out << "}}";
+    }
+    out << "\n]}\n";
+
+    return !out.fail();
+  }
+
+  static void PutBytes(std::ostream &out, uint64_t value, size_t count)
+  {
+    // Little endian, whatever the host is
+    for (size_t i = 0; i < count; ++i)
+      out.put((char)((value >> (i * 8)) & 0xFF));
+  }
+
+  static bool GetBytes(std::istream &in, uint64_t &value, size_t count)
+  {
+    value = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      int c = in.get();
+      if (c == EOF)
+        return false;
+      value |= (uint64_t)(c & 0xFF) << (i * 8);
+    }
+    return true;
+  }
+
+  bool TraceRecorder::SaveBinary(std::ostream &out) const
+  {
+    std::vector<TraceEvent> events;
+    GetEvents(events);
+
+    out.write(kMagic, sizeof(kMagic));
+    PutBytes(out, kVersion, 4);
+    PutBytes(out, events.size(), 8);
+    PutBytes(out, Dropped(), 8);
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+      PutBytes(out, events[i].Time, 8);
+      PutBytes(out, events[i].Offset, 4);
+      PutBytes(out, events[i].Value, 2);
+      PutBytes(out, (uint64_t)events[i].Type, 1);
+      PutBytes(out, 0, 1);
+    }
+
+    return !out.fail();
+  }
+
+  bool TraceRecorder::LoadBinary(std::istream &in)
+  {
+    Clear();
+
+    char magic[sizeof(kMagic)];
+    uint64_t version, count, dropped;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kMagic))
+      return false;
+    if (!GetBytes(in, version, 4) || (version != kVersion) || !GetBytes(in, count, 8) || !GetBytes(in, dropped, 8))
+      return false;
+
+    // Grown as read, so a broken count cannot make us allocate much
+    std::vector<TraceEvent> events;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      uint64_t time, offset, value, type, reserved;
+      if (!GetBytes(in, time, 8) || !GetBytes(in, offset, 4) || !GetBytes(in, value, 2) ||
+          !GetBytes(in, type, 1) || !GetBytes(in, reserved, 1) || (type > (uint64_t)TraceEventType::Error))
+        return false;
+
+      TraceEvent event;
+      event.Time = time;
+      event.Offset = (uint32_t)offset;
+      event.Value = (uint16_t)value;
+      event.Type = (TraceEventType)type;
+      event.Reserved = 0;
+      events.push_back(event);
+    }
+
+    size_t size = Events_.size();
+    while (size < events.size())
+      size *= 2;
+    Events_.resize(size);
+    Mask_ = size - 1;
+
+    std::copy(events.begin(), events.end(), Events_.begin());
+    Next_ = events.size();
+    DroppedBefore_ = dropped;
+    InNanoseconds_ = true;
+    return true;
+  }
+}
@@ -0,0 +1,130 @@
+#ifndef GOLDCPP_TRACERECORDER_H
+#define GOLDCPP_TRACERECORDER_H
+
+#include "Symbol.h"
+#include "Production.h"
+#include <chrono>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #include <x86intrin.h>
+  #define GOLDCPP_TRACE_TSC
+#endif
+
+/* Parser reports its events to a TraceRecorder (see Parser::SetTraceRecorder())
+only if GOLDCPP_TRACE is defined. Like GOLDCPP_STATS, it changes the layout of
+Parser, so it must be defined the same way for every file that includes
+Parser.h. Without it, none of the tracing is compiled in. */
+#ifdef GOLDCPP_TRACE
+  #define GOLDCPP_TRACE_EVENT(type, value, offset) \
+    do { if (Trace_) Trace_->Record(TraceEventType::type, (uint16_t)(value), (offset)); } while (0)
+#else
+  #define GOLDCPP_TRACE_EVENT(type, value, offset) do {} while (0)
+#endif
+
+namespace GoldCPP
+{
+  enum class TraceEventType : uint8_t
+  {
+    Token = 0,        // Value is the symbol id of a token the lexer produced
+    Shift = 1,        // Value is the symbol id of the shifted token
+    Reduce = 2,       // Value is the production id
+    GroupPush = 3,    // Value is the symbol id of the group's start
+    GroupPop = 4,     // Value is the symbol id of the group's start
+    Error = 5         // Value is the ParseMessage returned
+  };
+
+  struct TraceEvent
+  {
+    uint64_t Time;          // Ticks while recording, nanoseconds once taken out by GetEvents()
+    uint32_t Offset;        // In the source text
+    uint16_t Value;
+    TraceEventType Type;
+    uint8_t Reserved;
+  };
+
+  /* A flight recorder: keeps the last Capacity() events in a buffer allocated
+  up front, overwriting the oldest ones, so it can stay on all the time and be
+  dumped when something went wrong. Recording an event takes a timestamp and
+  four stores, and never allocates. */
+  class TraceRecorder
+  {
+  private:
+    std::vector<TraceEvent> Events_;
+    size_t Mask_;                 // Capacity - 1, capacity is a power of two
+    uint64_t Next_;               // Number of events recorded since Clear()
+    uint64_t DroppedBefore_;      // By the recorder that saved the loaded events
+
+    // For converting ticks to nanoseconds
+    uint64_t StartTicks_;
+    std::chrono::steady_clock::time_point StartTime_;
+    bool InNanoseconds_;          // Loaded events are in nanoseconds already
+
+#ifndef __GNUC__
+    TraceRecorder(const TraceRecorder& that){}
+#else
+    TraceRecorder(const TraceRecorder& that) = delete;
+#endif
+
+    static uint64_t Now()
+    {
+#ifdef GOLDCPP_TRACE_TSC
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    double NanosecondsPerTick() const;
+
+  public:
+
+    /* Holds the last 'capacity' events, rounded up to a power of two. */
+    explicit TraceRecorder(size_t capacity = 65536);
+
+    void Record(TraceEventType type, uint16_t value, size_t offset)
+    {
+      TraceEvent &event = Events_[(size_t)Next_ & Mask_];
+      event.Time = Now();
+      event.Offset = (uint32_t)offset;
+      event.Value = value;
+      event.Type = type;
+      ++Next_;
+    }
+
+    /* Drops all events, and starts timing anew. */
+    void Clear();
+
+    size_t Capacity() const
+    {
+      return Events_.size();
+    }
+
+    /* Number of events held. */
+    size_t Count() const;
+
+    /* Number of events overwritten since Clear(). */
+    uint64_t Dropped() const;
+
+    /* The events held, oldest first, with times in nanoseconds since the first. */
+    void GetEvents(std::vector<TraceEvent> &out) const;
+
+    /* Writes the events in the Chrome trace event format, to be viewed in
+    chrome://tracing or Perfetto. Symbols and productions are shown by their
+    text if their tables are given, by id otherwise. */
+    bool SaveChromeTrace(std::ostream &out, const SymbolList *symbols = NULL, const ProductionList *productions = NULL) const;
+
+    /* Writes the events in a compact binary form, 16 bytes per event. */
+    bool SaveBinary(std::ostream &out) const;
+
+    /* Reads events written by SaveBinary(), such as to convert them with
+    SaveChromeTrace() later. Returns false and leaves the recorder empty if
+    the input is not such a file. The capacity grows to fit them. */
+    bool LoadBinary(std::istream &in);
+  };
+}
+
+#endif // GOLDCPP_TRACERECORDER_H
@@ -0,0 +1,412 @@
+#include "TreeCursor.h"
+#include "Production.h"
+
+namespace GoldCPP
+{
+  TreeCursor::TreeCursor() :
+    States_(NULL),
+    TakenIndex_(0)
+  {}
+
+  void TreeCursor::Clear()
+  {
+    Frames_.clear();
+    Edit_ = TextEdit();
+    States_ = NULL;
+    TakenTail_ = NULL;
+    TakenIndex_ = 0;
+  }
+
+  bool TreeCursor::Seek(const std::shared_ptr<Reduction> &root, uint16_t initialState, size_t bound)
+  {
+    /* Finds the last terminal ending before 'bound'. Subtrees are tried from
+    right to left, and we need to backtrack if a subtree starting before
+    'bound' only has terminals ending behind it. Frame indices count down here. */
+
+    Frames_.clear();
+    Frames_.push_back(Frame(root, root->Branches.Count(), 0, false));
+    while (!Frames_.empty())
+    {
+      if (Frames_.back().Index == 0)    // Nothing left to try here
+      {
+        Frames_.pop_back();
+        continue;
+      }
+
+      Frame &f = Frames_.back();
+      --f.Index;
+      const std::shared_ptr<Token> &item = f.Node->Branches[f.Index];
+      Span loc = Locate(f, f.Index);
+      if (loc.Begin >= bound)
+        continue;
+
+      if (item->GetType() != Symbol::SymbolType::Nonterminal)
+      {
+        if (loc.End < bound)
+          break;
+      }
+      else if (item->ReductionData && (loc.End > loc.Begin))
+      {
+        const std::shared_ptr<Reduction> &node = item->ReductionData;
+        ptrdiff_t shift = f.Shift + f.Node->GetShift(f.Index);
+        Frames_.push_back(Frame(node, node->Branches.Count(), shift, false));
+      }
+    }
+
+    if (Frames_.empty())
+      return false;
+
+    // A first branch starts where its parent did
+    for (size_t i = 0; i < Frames_.size(); ++i)
+    {
+      Frame &f = Frames_[i];
+      Enter(f, (i > 0) ? Frames_[i - 1].PreState : initialState);
+      f.PreState = StateBefore(f);
+    }
+
+    return true;
+  }
+
+  void TreeCursor::Enter(Frame &f, uint16_t startState) const
+  {
+    f.StartState = startState;
+    f.TailLength = 0;
+
+    // Each tail of a flattened list is parsed in the state the list itself was pushed in
+    const Production *prod = f.Node->Parent;
+    if (prod && (prod->Handle.Count() > 1) && (f.Node->Branches.Count() > prod->Handle.Count()))
+    {
+      const LRAction *action = (*States_)[startState].GetActionForSymbol(prod->Head);
+      if (action)
+      {
+        f.ListState = action->Value;
+        f.TailLength = prod->Handle.Count() - 1;
+      }
+    }
+  }
+
+  uint16_t TreeCursor::StateBefore(const Frame &f) const
+  {
+    // Only valid until the branch left of the current item is pushed again, which changes its State
+    if (f.Index == 0)
+      return f.StartState;
+    if ((f.TailLength > 0) && ((f.Index - 1) % f.TailLength == 0))
+      return f.ListState;
+    return f.Node->Branches[f.Index - 1]->State;
+  }
+
+  Span TreeCursor::Locate(const Frame &f, size_t index) const
+  {
+    return f.Node->Branches[index]->Location.Shifted(f.Shift + f.Node->GetShift(index));
+  }
+
+  bool TreeCursor::Reset(const std::shared_ptr<Reduction> &root, const LRStateList &states, const TextEdit &edit)
+  {
+    Edit_ = edit;
+    States_ = &states;
+    TakenTail_ = NULL;
+
+    if (Seek(root, states.InitialState, edit.Offset) && Seek(root, states.InitialState, CurrentLocation().Begin + 1))
+      return true;
+
+    Frames_.clear();
+    Frames_.push_back(Frame(root, 0, 0, false));
+    Enter(Frames_.back(), states.InitialState);
+    Frames_.back().PreState = states.InitialState;
+    Normalize();
+    return false;
+  }
+
+  std::shared_ptr<Token> TreeCursor::LeftList(const Frame &f, size_t count) const
+  {
+    /* A new node for the first 'count' branches of a flattened list, as the
+    list was on the stack right before the current tail. They are shared with
+    the previous node, so they are shifted by the new node, which needs them
+    all shifted the same. */
+
+    Reduction &from = *f.Node;
+    EvenShift(from, 0, count);
+    ptrdiff_t shift = f.Shift + from.GetShift(0);
+
+    std::shared_ptr<Reduction> node = std::make_shared<Reduction>(count);
+    node->Parent = from.Parent;
+    for (size_t i = 0; i < count; ++i)
+      node->Branches[i] = from.Branches[i];
+
+    // Tails added later are where they are
+    node->Shift = shift;
+    node->ShiftFrom = count;
+    node->ShiftBy = -shift;
+    node->Location = Span(from.Branches[0]->Location.Begin, from.Branches[count - 1]->Location.End).Shifted(shift);
+
+    std::shared_ptr<Token> head = std::make_shared<Token>(from.Parent->Head, node);
+    head->State = f.ListState;
+    head->Location = node->Location;
+    head->Source = from.Branches[0]->Source;
+    return head;
+  }
+
+  void TreeCursor::PushLeftContext(TokenStack &stack) const
+  {
+    for (size_t i = 0; i < Frames_.size(); ++i)
+    {
+      const Frame &f = Frames_[i];
+      size_t n = 0;
+
+      // The tails of a list before the current one were reduced into the list already
+      if ((f.TailLength > 0) && (f.Index > 1))
+      {
+        size_t tailStart = f.Index - (f.Index - 1) % f.TailLength;
+        if (tailStart > 1)
+        {
+          stack.push(LeftList(f, tailStart));
+          n = tailStart;
+        }
+      }
+
+      for (; n < f.Index; ++n)
+      {
+        const std::shared_ptr<Token> &item = f.Node->Branches[n];
+        ptrdiff_t shift = f.Shift + f.Node->GetShift(n);
+        if (shift != 0)
+          Rebase(*item, shift);
+        stack.push(item);
+      }
+    }
+  }
+
+  std::shared_ptr<Token> TreeCursor::Current() const
+  {
+    if (Frames_.empty())
+      return NULL;
+
+    const Frame &f = Frames_.back();
+    return f.Node->Branches[f.Index];
+  }
+
+  Span TreeCursor::CurrentLocation() const
+  {
+    const Frame &f = Frames_.back();
+    return Locate(f, f.Index);
+  }
+
+  uint16_t TreeCursor::PreState() const
+  {
+    return Frames_.back().PreState;
+  }
+
+  void TreeCursor::Normalize()
+  {
+    // Leave finished subtrees. Their tokens were not pushed, so their State is still the previous one.
+    while (!Frames_.empty() && (Frames_.back().Index >= Frames_.back().Node->Branches.Count()))
+    {
+      Frames_.pop_back();
+      if (!Frames_.empty())
+      {
+        Frame &f = Frames_.back();
+        ++f.Index;
+        f.PreState = StateBefore(f);
+      }
+    }
+  }
+
+  void TreeCursor::Advance()
+  {
+    Frame &f = Frames_.back();
+    ++f.Index;
+    f.PreState = StateBefore(f);
+    Normalize();
+  }
+
+  void TreeCursor::Descend(bool moved)
+  {
+    std::shared_ptr<Token> item = Current();
+    if (!item->ReductionData)
+    {
+      Advance();
+      return;
+    }
+
+    // A moved item was put where it is in the edited text, see Take()
+    const Frame &f = Frames_.back();
+    ptrdiff_t shift = moved ? 0 : f.Shift + f.Node->GetShift(f.Index);
+    uint16_t state = f.PreState;
+    Frames_.push_back(Frame(item->ReductionData, 0, shift, moved));
+    Enter(Frames_.back(), state);
+    Frames_.back().PreState = state;
+    Normalize();
+  }
+
+  void TreeCursor::Descend()
+  {
+    Descend(true);
+  }
+
+  ptrdiff_t TreeCursor::Delta() const
+  {
+    return (ptrdiff_t)Edit_.Inserted - (ptrdiff_t)Edit_.Removed;
+  }
+
+  size_t TreeCursor::NewOffset(size_t offset) const
+  {
+    // Only for offsets behind the edit
+    return offset + Delta();
+  }
+
+  bool TreeCursor::Sync(const Token &read)
+  {
+    size_t editEnd = Edit_.Offset + Edit_.Removed;
+
+    std::shared_ptr<Token> item;
+    Span loc;
+    while ((item = Current()))
+    {
+      loc = CurrentLocation();
+      bool behindEdit = (loc.Begin >= editEnd);
+
+      if ((loc.End <= Edit_.Offset) || (behindEdit && (NewOffset(loc.End) <= read.Location.Begin) && (loc.End > loc.Begin)))
+        Advance();      // Already lexed again
+      else if (item->GetType() == Symbol::SymbolType::Nonterminal)
+        Descend(false);
+      else if (behindEdit && (NewOffset(loc.Begin) >= read.Location.Begin))
+        break;
+      else
+        Advance();
+    }
+
+    if (!item || (NewOffset(loc.Begin) != read.Location.Begin) ||
+        (item->Parent != read.Parent) || (loc.Length() != read.Location.Length()))
+      return false;
+
+    // Everything from here on is lexed the same as before, start with the largest subtree we can
+    while ((Frames_.size() > 1) && (Frames_.back().Index == 0))
+      Frames_.pop_back();
+
+    return true;
+  }
+
+  std::shared_ptr<Token> TreeCursor::Take()
+  {
+    std::shared_ptr<Token> item = Current();
+    if (!item)
+      return item;
+
+    const Frame &f = Frames_.back();
+    ptrdiff_t shift = f.Shift + f.Node->GetShift(f.Index) + (f.Moved ? 0 : Delta());
+    if (shift != 0)
+      Rebase(*item, shift);
+
+    if ((f.TailLength > 0) && (f.Index > 1) && ((f.Index - 1) % f.TailLength == 0))
+    {
+      TakenTail_ = item;
+      TakenIndex_ = f.Index;
+    }
+    else
+    {
+      TakenTail_ = NULL;
+    }
+
+    return item;
+  }
+
+  size_t TreeCursor::TakeListTails(const std::shared_ptr<Token> &item, uint16_t state, Reduction &list)
+  {
+    if (!item || (item != TakenTail_) || Frames_.empty())
+      return 0;
+
+    // A terminal was passed already, see Parser::TakeReusedInput()
+    Frame &f = Frames_.back();
+    Reduction &from = *f.Node;
+    size_t count = from.Branches.Count();
+    size_t index = TakenIndex_ + ((item->GetType() != Symbol::SymbolType::Nonterminal) ? 1 : 0);
+    if ((TakenIndex_ >= count) || (from.Branches[TakenIndex_] != item) || (f.Index != index) ||
+        (state != f.ListState) || (list.Parent != from.Parent) || (list.Branches.Count() == 0))
+      return 0;
+
+    // The tails keep their locations, shifted by the list all the same
+    EvenShift(from, TakenIndex_ + 1, count);
+    ptrdiff_t shift = f.Shift + (f.Moved ? 0 : Delta()) + from.GetShift(count - 1);
+    if (shift != 0)
+      Rebase(*item, -shift);
+
+    size_t at = list.Branches.Count();
+    EvenShift(list, 0, at);
+    ptrdiff_t before = list.GetShift(at - 1);
+    list.Shift = before;
+    list.ShiftFrom = at;
+    list.ShiftBy = shift - before;
+
+    for (size_t i = TakenIndex_; i < count; ++i)
+      list.Branches.Add(from.Branches[i]);
+    list.Location.End = from.Branches[count - 1]->Location.End + shift;
+
+    size_t added = count - TakenIndex_;
+    TakenTail_ = NULL;
+    f.Index = count;
+    Normalize();
+    return added;
+  }
+
+  void TreeCursor::EvenShift(Reduction &node, size_t begin, size_t end)
+  {
+    /* Makes GetShift() the same for branches 'begin' to 'end' of 'node', by
+    moving its split into either end of them. The fewer branches are moved. */
+
+    size_t from = node.ShiftFrom;
+    if ((node.ShiftBy == 0) || (from <= begin) || (from >= end))
+      return;
+
+    if (from - begin <= end - from)
+    {
+      for (size_t i = begin; i < from; ++i)
+        Rebase(*node.Branches[i], -node.ShiftBy);
+      node.ShiftFrom = begin;
+    }
+    else
+    {
+      for (size_t i = from; i < end; ++i)
+        Rebase(*node.Branches[i], node.ShiftBy);
+      node.ShiftFrom = end;
+    }
+  }
+
+  void TreeCursor::Rebase(Token &item, ptrdiff_t by)
+  {
+    item.Location = item.Location.Shifted(by);
+    if (item.ReductionData)
+    {
+      Reduction &node = *item.ReductionData;
+      node.Location = node.Location.Shifted(by);
+      node.Shift += by;
+    }
+  }
+
+  std::shared_ptr<Token> TreeCursor::FirstTerminal(const std::shared_ptr<Token> &subtree)
+  {
+    if (subtree->GetType() != Symbol::SymbolType::Nonterminal)
+      return subtree;
+    if (!subtree->ReductionData)
+      return NULL;
+
+    // Depth-first, because empty subtrees may come before the first terminal
+    std::vector<std::pair<Reduction*, size_t>> pending;
+    pending.push_back(std::make_pair(subtree->ReductionData.get(), (size_t)0));
+    while (!pending.empty())
+    {
+      std::pair<Reduction*, size_t> &top = pending.back();
+      if (top.second >= top.first->Branches.Count())
+      {
+        pending.pop_back();
+        continue;
+      }
+
+      const std::shared_ptr<Token> &branch = top.first->Branches[top.second++];
+      if (branch->GetType() != Symbol::SymbolType::Nonterminal)
+        return branch;
+      if (branch->ReductionData)
+        pending.push_back(std::make_pair(branch->ReductionData.get(), (size_t)0));
+    }
+
+    return NULL;
+  }
+}
@@ -0,0 +1,126 @@
+#ifndef GOLDCPP_TREECURSOR_H
+#define GOLDCPP_TREECURSOR_H
+
+#include "Token.h"
+#include "TokenStack.h"
+#include "Reduction.h"
+#include "LrState.h"
+#include "TextEdit.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace GoldCPP
+{
+  /* Walks the tree of a previous parse in source order, for reuse after an
+  edit of the source. The current item is always a branch of some Reduction.
+  The cursor knows the LALR state the previous parse was in right before the
+  current item was pushed, which is derived from the State of the branches
+  left of it (or of its parent's left siblings), or from the tables for the
+  tails of flattened lists (see Parser::FlattenList()), which are told apart
+  by having more branches than their production has handle symbols.
+
+  Items are moved to their new locations when they are handed out with
+  Take(), which only updates the item itself: the subtree below it is left
+  as it is, and shifted through Reduction::GetShift(). The previous tree is
+  updated in place, and taken over by the new one. */
+  class TreeCursor
+  {
+  private:
+    struct Frame
+    {
+      std::shared_ptr<Reduction> Node;
+      size_t Index;         // Branch of Node that is the current item
+      ptrdiff_t Shift;      // Of Node itself, the sum of GetShift() above it
+      bool Moved;           // Shift is into the edited text, as Node was taken already
+      uint16_t PreState;    // LALR state before the current item was pushed
+      uint16_t StartState;  // LALR state before the first branch was pushed
+      uint16_t ListState;   // LALR state before each tail, if Node is a list
+      size_t TailLength;    // Branches per tail if Node is a flattened list, 0 otherwise
+
+      Frame(const std::shared_ptr<Reduction> &node, size_t index, ptrdiff_t shift, bool moved) :
+        Node(node), Index(index), Shift(shift), Moved(moved), PreState(0), StartState(0), ListState(0), TailLength(0)
+      {}
+    };
+
+    std::vector<Frame> Frames_;
+    TextEdit Edit_;
+    const LRStateList *States_;         // Of the tables the tree was parsed with
+
+    // Item last handed out by Take() if it starts a tail of a list, see TakeListTails()
+    std::shared_ptr<Token> TakenTail_;
+    size_t TakenIndex_;
+
+    bool Seek(const std::shared_ptr<Reduction> &root, uint16_t initialState, size_t bound);
+    void Enter(Frame &f, uint16_t startState) const;
+    uint16_t StateBefore(const Frame &f) const;
+    Span Locate(const Frame &f, size_t index) const;
+    void Normalize();
+    void Descend(bool moved);
+    ptrdiff_t Delta() const;
+    size_t NewOffset(size_t offset) const;
+    std::shared_ptr<Token> LeftList(const Frame &f, size_t count) const;
+    static void EvenShift(Reduction &node, size_t begin, size_t end);
+
+  public:
+
+    TreeCursor();
+
+    void Clear();
+
+    /* Positions the cursor on the first terminal that has to be lexed again
+    after 'edit'. That is one token before the last token ending before the
+    edit, because the DFA may have looked at the edited text while matching it.
+    Returns false if the whole text needs to be lexed again. */
+    bool Reset(const std::shared_ptr<Reduction> &root, const LRStateList &states, const TextEdit &edit);
+
+    /* Pushes what the LALR stack held right before the current item was read:
+    the branches left of the current position, with the items of a list
+    before the current tail made into a new list node. */
+    void PushLeftContext(TokenStack &stack) const;
+
+    /* The current item, or NULL if the whole tree has been walked. */
+    std::shared_ptr<Token> Current() const;
+
+    /* Where the current item is in the previous text. */
+    Span CurrentLocation() const;
+
+    /* LALR state of the previous parse right before the current item was pushed. */
+    uint16_t PreState() const;
+
+    /* Skips ahead to the first terminal at or behind 'read' in the edited
+    text. Returns true if that terminal is the same as 'read'. In that case
+    the cursor is moved up to the largest subtree starting with it, and the
+    rest of the tree can be reused from there. */
+    bool Sync(const Token &read);
+
+    /* Returns the current item after moving it to its new location. */
+    std::shared_ptr<Token> Take();
+
+    /* The current item has been used. */
+    void Advance();
+
+    /* The current item cannot be used as a whole, continue with its branches. */
+    void Descend();
+
+    /* If 'item', the item last handed out by Take(), starts a tail of a list
+    that the parser is about to continue in 'state', and 'list' is made by
+    the same production, adds it and all tails after it to the end of 'list'
+    and continues behind them. They would be parsed in the same states as
+    before, one tail at a time. Only pointers are moved, and the locations in
+    them are left as they are (see Reduction::GetShift()).
+    Returns the number of branches added, 0 if none. */
+    size_t TakeListTails(const std::shared_ptr<Token> &item, uint16_t state, Reduction &list);
+
+    /* Leftmost terminal in a subtree, or NULL if the subtree is empty. */
+    static std::shared_ptr<Token> FirstTerminal(const std::shared_ptr<Token> &subtree);
+
+    /* Moves 'item' into a place that is shifted 'by' less (see
+    Reduction::GetShift()), keeping it and its subtree where they are in the
+    source. Changes the item in place. */
+    static void Rebase(Token &item, ptrdiff_t by);
+  };
+}
+
+#endif // GOLDCPP_TREECURSOR_H
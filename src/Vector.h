@@ -1,6 +1,7 @@
 #ifndef GOLDCPP_VECTOR_H
 #define GOLDCPP_VECTOR_H
 
+#include "TableAllocator.h"
 #include <vector>
 #include <cstddef>
 #include <cassert>
@@ -14,22 +15,19 @@ namespace GoldCPP
   class Vector
   {
   private:
-    std::vector<T> vector_;
+    TableVector<T> vector_;
 
   public:
     Vector(size_t initSize = 0, const T& val = T()) :
       vector_(initSize, val)
     {}
 
-    virtual ~Vector()
-    {}
-
     void Add(const T &elem)
     {
       vector_.push_back(elem);
     }
 
-    virtual void Clear()
+    void Clear()
     {
       vector_.clear();
     }
@@ -39,6 +37,11 @@ namespace GoldCPP
       return vector_.size();
     }
 
+    size_t Capacity() const
+    {
+      return vector_.capacity();
+    }
+
     T& operator[] (size_t index)
     {
       assert(index < vector_.size());
@@ -92,6 +95,11 @@ namespace GoldCPP
       vector_.reserve(nElems);
     }
 
+    void Resize(size_t nElems)
+    {
+      vector_.resize(nElems);
+    }
+
   };
 
 }